@@ -21,6 +21,7 @@
 #define _DIRECTIO_H 1
 
 #include "include/ports.h"
+#include "include/delay.h"
 
 #ifndef INPUT_PULLUP
 // for boards that don't support pullups
@@ -73,6 +74,13 @@ class Output {
             write(value);
             write(! value);
         }
+        template <u32 width_ns>
+        void pulse(boolean value=HIGH) {
+            // emit a pulse at least width_ns nanoseconds wide
+            write(value);
+            delay_ns<width_ns>();
+            write(! value);
+        }
         boolean read() {
             return _pins<pin>::output_read();
         }
@@ -106,6 +114,13 @@ class OutputLow {
             write(value);
             write(! value);
         }
+        template <u32 width_ns>
+        void pulse(boolean value=LOW) {
+            // emit a pulse at least width_ns nanoseconds wide
+            write(value);
+            delay_ns<width_ns>();
+            write(! value);
+        }
         boolean read() {
             return !_pins<pin>::output_read();
         }
@@ -114,6 +129,51 @@ class OutputLow {
         }
 };
 
+template <u8 pin>
+class OpenDrain {
+    // An open drain output with direct port I/O, for wired-AND buses
+    // such as I2C. Writing LOW drives the pin low; writing HIGH releases
+    // it so that the external pullup (or another device) sets the level.
+    // The output latch is held low and only the pin direction is switched,
+    // so the pin never actively drives the line high.
+    public:
+        OpenDrain(boolean initial_value=HIGH) {
+            pinMode(pin, INPUT);
+
+            // include a call to digitalWrite here which will
+            // turn off PWM on this pin, if needed
+            digitalWrite(pin, LOW);
+            _pins<pin>::output_write(LOW);
+            write(initial_value);
+        }
+        void write(boolean value) {
+            _pins<pin>::output_enable(! value);
+        }
+        OpenDrain& operator =(boolean value) {
+            write(value);
+            return *this;
+        }
+        void pulse(boolean value=LOW) {
+            write(value);
+            write(! value);
+        }
+        template <u32 width_ns>
+        void pulse(boolean value=LOW) {
+            // emit a pulse at least width_ns nanoseconds wide
+            write(value);
+            delay_ns<width_ns>();
+            write(! value);
+        }
+        boolean read() {
+            // returns the actual line level, which may be held
+            // low by another device while this pin is released.
+            return _pins<pin>::input_read();
+        }
+        operator boolean() {
+            return read();
+        }
+};
+
 template <class port, u8 start_bit=0, u8 nbits=8>
 class InputPort {
     // A set of digital inputs which are contiguous and
@@ -122,6 +182,14 @@ class InputPort {
     // in order to gain fast, simultaneous
     // multi-bit reads and writes.
     public:
+        // number of bits in the port
+        static const u8 width = nbits;
+
+        // the MCU port and the bits used within it (see OutputPort)
+        typedef port port_type;
+        static const u8 first_bit = start_bit;
+        static const port_data_t mask = ((port_data_t(1) << nbits) - 1) << start_bit;
+
         InputPort() {
             setup();
         }
@@ -131,17 +199,14 @@ class InputPort {
             port::port_enable_inputs(mask);
         }
 
-        u8 read() {
+        port_data_t read() {
             // mask to select bits of interest, then shift so
             // that output can be treated as normal integers.
-            return (*port_t(port::in) & mask) >> start_bit;
+            return (port::port_input_read() & mask) >> start_bit;
         }
-        operator u8() {
+        operator port_data_t() {
             return read();
         }
-
-    private:
-        static const u8 mask = ((u8(1) << nbits) - 1) << start_bit;
 };
 
 template <class port, u8 start_bit=0, u8 nbits=8>
@@ -152,6 +217,14 @@ class OutputPort {
     // in order to gain fast, simultaneous
     // multi-bit reads and writes.
     public:
+        static const u8 width = nbits;
+
+        // the MCU port and the bits used within it,
+        // for drivers that access the port registers directly
+        typedef port port_type;
+        static const u8 first_bit = start_bit;
+        static const port_data_t mask = ((port_data_t(1) << nbits) - 1) << start_bit;
+
         OutputPort() {
             setup();
         }
@@ -183,9 +256,6 @@ class OutputPort {
         operator port_data_t() {
             return read();
         }
-
-    private:
-        static const port_data_t mask = ((port_data_t(1) << nbits) - 1) << start_bit;
 };
 
 template <class port>
@@ -196,28 +266,226 @@ class OutputPort<port, 0, 8 * sizeof(port_data_t)> {
     // bit manipulation required, and also eliminates
     // the need to disable/reenable interrupts during writes.
     public:
+        static const u8 width = 8 * sizeof(port_data_t);
+
+        typedef port port_type;
+        static const u8 first_bit = 0;
+        static const port_data_t mask = port_data_t(-1);
+
         OutputPort() {
             setup();
         }
 
         void setup() {
             // set port pin directions to output
-            port::port_enable_outputs(-1);
+            port::port_enable_outputs(mask);
         }
 
-        void write(u8 value) {
+        void write(port_data_t value) {
             port::port_output_write(value);
         }
-        OutputPort& operator =(u8 value) {
+        OutputPort& operator =(port_data_t value) {
             write(value);
             return *this;
         }
-        u8 read() {
+        port_data_t read() {
             return port::port_output_read();
         }
-        operator u8() {
+        operator port_data_t() {
+            return read();
+        }
+};
+
+template <u8 pin>
+class BiDirectional {
+    // A digital pin on a shared bus, which can be switched between
+    // input and output at runtime. make_input() and make_output()
+    // only change the pin direction, which is a single register write.
+    // The pin starts as an input. Note that on AVR boards, the value
+    // written while the pin is an input controls the pullup.
+    public:
+        BiDirectional() {
+            pinMode(pin, INPUT);
+
+            // include a call to digitalWrite here which will
+            // turn off PWM on this pin, if needed
+            digitalWrite(pin, LOW);
+            _pins<pin>::output_write(LOW);
+        }
+        void make_input() {
+            _pins<pin>::output_enable(false);
+        }
+        void make_output() {
+            _pins<pin>::output_enable(true);
+        }
+        void write(boolean value) {
+            _pins<pin>::output_write(value);
+        }
+        BiDirectional& operator =(boolean value) {
+            write(value);
+            return *this;
+        }
+        boolean read() {
+            // returns the pin level, whether it is an input or an output
+            return _pins<pin>::input_read();
+        }
+        operator boolean() {
+            return read();
+        }
+
+        template <class strobe_t>
+        boolean read_strobed(strobe_t& strobe, boolean active=LOW) {
+            // Turn the bus around and read it: switch to input,
+            // assert the device's read strobe, sample the pin and
+            // release the strobe. The pin is left as an input.
+            return read_strobed<0>(strobe, active);
+        }
+
+        template <u32 access_ns, class strobe_t>
+        boolean read_strobed(strobe_t& strobe, boolean active=LOW) {
+            // As above, waiting at least access_ns nanoseconds
+            // after asserting the strobe for the device to respond.
+            make_input();
+            strobe = active;
+            delay_ns<access_ns>();
+
+            // allow for the input synchronizer delay
+            __asm__ __volatile__ ("nop");
+            boolean value = read();
+            strobe = !active;
+            return value;
+        }
+};
+
+template <class port, u8 start_bit=0, u8 nbits=8>
+class BiDirectionalPort {
+    // A set of contiguous digital I/O in a single MCU port
+    // (see InputPort and OutputPort), for parallel data buses
+    // that are both read and written. make_input() and make_output()
+    // switch the direction of all the bits at once.
+    // The port starts as an input.
+    public:
+        static const u8 width = nbits;
+
+        // the MCU port and the bits used within it (see OutputPort)
+        typedef port port_type;
+        static const u8 first_bit = start_bit;
+        static const port_data_t mask = ((port_data_t(1) << nbits) - 1) << start_bit;
+
+        BiDirectionalPort() {
+            setup();
+        }
+
+        void setup() {
+            // configure the port pins as inputs
+            port::port_enable_inputs(mask);
+        }
+
+        void make_input() {
+            port::port_make_inputs(mask);
+        }
+        void make_output() {
+            port::port_make_outputs(mask);
+        }
+
+        void write(port_data_t value) {
+            atomic {
+                // read-modify-write cycle on the output register, not the
+                // pin levels: on AVR, writing back the levels of input
+                // pins would turn their pullups on or off
+                port_data_t v = port::port_output_latch();
+                port_data_t shifted = value << start_bit;
+                v |= shifted & mask;
+                v &= (shifted | ~mask);
+                port::port_output_write(v);
+            }
+        }
+        BiDirectionalPort& operator =(port_data_t value) {
+            write(value);
+            return *this;
+        }
+        port_data_t read() {
+            // returns the pin levels, whether the port is an input or an output
+            return (port::port_input_read() & mask) >> start_bit;
+        }
+        operator port_data_t() {
             return read();
         }
+
+        template <class strobe_t>
+        port_data_t read_strobed(strobe_t& strobe, boolean active=LOW) {
+            // Turn the bus around and read it (see BiDirectional::read_strobed).
+            // The port is left as an input.
+            return read_strobed<0>(strobe, active);
+        }
+
+        template <u32 access_ns, class strobe_t>
+        port_data_t read_strobed(strobe_t& strobe, boolean active=LOW) {
+            make_input();
+            strobe = active;
+            delay_ns<access_ns>();
+            __asm__ __volatile__ ("nop");
+            port_data_t value = read();
+            strobe = !active;
+            return value;
+        }
+};
+
+template <class port>
+class BiDirectionalPort<port, 0, 8 * sizeof(port_data_t)> {
+    // Specialization for a complete MCU port.
+    // As with OutputPort, writes don't need a read/modify/write cycle.
+    public:
+        static const u8 width = 8 * sizeof(port_data_t);
+
+        typedef port port_type;
+        static const u8 first_bit = 0;
+        static const port_data_t mask = port_data_t(-1);
+
+        BiDirectionalPort() {
+            setup();
+        }
+
+        void setup() {
+            port::port_enable_inputs(mask);
+        }
+
+        void make_input() {
+            port::port_make_inputs(mask);
+        }
+        void make_output() {
+            port::port_make_outputs(mask);
+        }
+
+        void write(port_data_t value) {
+            port::port_output_write(value);
+        }
+        BiDirectionalPort& operator =(port_data_t value) {
+            write(value);
+            return *this;
+        }
+        port_data_t read() {
+            return port::port_input_read();
+        }
+        operator port_data_t() {
+            return read();
+        }
+
+        template <class strobe_t>
+        port_data_t read_strobed(strobe_t& strobe, boolean active=LOW) {
+            return read_strobed<0>(strobe, active);
+        }
+
+        template <u32 access_ns, class strobe_t>
+        port_data_t read_strobed(strobe_t& strobe, boolean active=LOW) {
+            make_input();
+            strobe = active;
+            delay_ns<access_ns>();
+            __asm__ __volatile__ ("nop");
+            port_data_t value = read();
+            strobe = !active;
+            return value;
+        }
 };
 
 #else // DIRECTIO_FALLBACK
@@ -263,6 +531,13 @@ class Output {
             write(value);
             write(! value);
         }
+        template <u32 width_ns>
+        void pulse(boolean value=HIGH) {
+            // emit a pulse at least width_ns nanoseconds wide
+            write(value);
+            delay_ns<width_ns>();
+            write(! value);
+        }
         boolean read() {
             return digitalRead(pin);
         }
@@ -293,6 +568,13 @@ class OutputLow {
             write(value);
             write(! value);
         }
+        template <u32 width_ns>
+        void pulse(boolean value=LOW) {
+            // emit a pulse at least width_ns nanoseconds wide
+            write(value);
+            delay_ns<width_ns>();
+            write(! value);
+        }
         boolean read() {
             return !digitalRead(pin);
         }
@@ -301,7 +583,90 @@ class OutputLow {
         }
 };
 
-// TODO: fallbacks for InputPort and OutputPort
+template <u8 pin>
+class OpenDrain {
+    // An open drain output, emulated by switching the pin mode
+    public:
+        OpenDrain(boolean initial_value=HIGH) {
+            pinMode(pin, INPUT);
+            write(initial_value);
+        }
+        void write(boolean value) {
+            if(value) {
+                pinMode(pin, INPUT);
+            }
+            else {
+                digitalWrite(pin, LOW);
+                pinMode(pin, OUTPUT);
+            }
+        }
+        OpenDrain& operator =(boolean value) {
+            write(value);
+            return *this;
+        }
+        void pulse(boolean value=LOW) {
+            write(value);
+            write(! value);
+        }
+        template <u32 width_ns>
+        void pulse(boolean value=LOW) {
+            // emit a pulse at least width_ns nanoseconds wide
+            write(value);
+            delay_ns<width_ns>();
+            write(! value);
+        }
+        boolean read() {
+            return digitalRead(pin);
+        }
+        operator boolean() {
+            return read();
+        }
+};
+
+template <u8 pin>
+class BiDirectional {
+    // A pin on a shared bus, switching direction via pinMode
+    public:
+        BiDirectional() {
+            pinMode(pin, INPUT);
+        }
+        void make_input() {
+            pinMode(pin, INPUT);
+        }
+        void make_output() {
+            pinMode(pin, OUTPUT);
+        }
+        void write(boolean value) {
+            digitalWrite(pin, value);
+        }
+        BiDirectional& operator =(boolean value) {
+            write(value);
+            return *this;
+        }
+        boolean read() {
+            return digitalRead(pin);
+        }
+        operator boolean() {
+            return read();
+        }
+
+        template <class strobe_t>
+        boolean read_strobed(strobe_t& strobe, boolean active=LOW) {
+            return read_strobed<0>(strobe, active);
+        }
+
+        template <u32 access_ns, class strobe_t>
+        boolean read_strobed(strobe_t& strobe, boolean active=LOW) {
+            make_input();
+            strobe = active;
+            delay_ns<access_ns>();
+            boolean value = read();
+            strobe = !active;
+            return value;
+        }
+};
+
+// TODO: fallbacks for InputPort, OutputPort and BiDirectionalPort
 
 #endif // DIRECTIO_FALLBACK
 
@@ -353,6 +718,8 @@ class Output<NO_PIN> {
         }
         void toggle() {}
         void pulse(boolean /*value*/=HIGH) {}
+        template <u32 width_ns>
+        void pulse(boolean /*value*/=HIGH) {}
 
         boolean read() {
             return LOW;
@@ -362,4 +729,56 @@ class Output<NO_PIN> {
         }
 };
 
+template <>
+class Input<NO_PIN> {
+    // An unused input, e.g. the spare slots of an InputGroup. Always reads LOW.
+    public:
+        Input(boolean /*pullup*/=true) {}
+        boolean read() {
+            return LOW;
+        }
+        operator boolean() {
+            return read();
+        }
+};
+
+template <u8 pin0, u8 pin1=NO_PIN, u8 pin2=NO_PIN, u8 pin3=NO_PIN,
+          u8 pin4=NO_PIN, u8 pin5=NO_PIN, u8 pin6=NO_PIN, u8 pin7=NO_PIN>
+class InputGroup {
+    // Up to 8 digital inputs on arbitrary pins, read together as one
+    // value like an InputPort: pin0 is bit 0, pin1 is bit 1, and so on.
+    // Each pin is read separately, so this is slower than an InputPort
+    // and the bits are not sampled at exactly the same time.
+    public:
+        // number of bits in the group
+        static const u8 width = 1 + (pin1 != NO_PIN) + (pin2 != NO_PIN) + (pin3 != NO_PIN) +
+            (pin4 != NO_PIN) + (pin5 != NO_PIN) + (pin6 != NO_PIN) + (pin7 != NO_PIN);
+
+        InputGroup(boolean pullup=true) :
+            in0(pullup), in1(pullup), in2(pullup), in3(pullup),
+            in4(pullup), in5(pullup), in6(pullup), in7(pullup) {}
+
+        u8 read() {
+            return in0.read() | (in1.read() << 1) | (in2.read() << 2) | (in3.read() << 3) |
+                (in4.read() << 4) | (in5.read() << 5) | (in6.read() << 6) | (in7.read() << 7);
+        }
+        operator u8() {
+            return read();
+        }
+
+    private:
+        Input<pin0> in0;
+        Input<pin1> in1;
+        Input<pin2> in2;
+        Input<pin3> in3;
+        Input<pin4> in4;
+        Input<pin5> in5;
+        Input<pin6> in6;
+        Input<pin7> in7;
+};
+
+#if !defined(DIRECTIO_FALLBACK)
+#include "include/debounce.h"
+#endif
+
 #endif // _DIRECTIO_H
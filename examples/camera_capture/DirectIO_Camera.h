@@ -0,0 +1,174 @@
+/*
+  DirectIO_Camera.h - Parallel camera capture using Direct IO library
+  Copyright (c) 2015-2018 Michael Marchetti.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <DirectIO.h>
+
+#if defined(DIRECTIO_FALLBACK)
+#error "ParallelCameraCapture requires direct I/O support (AVR, SAM or SAMD boards)"
+#endif
+
+template <class data_port, u8 pclk_pin, u8 href_pin, u8 vsync_pin,
+          u8 bytes_per_pixel=2, boolean vsync_active=HIGH, boolean href_active=HIGH>
+class ParallelCameraCapture {
+    // Captures image data from a camera with an 8 bit parallel output
+    // (OV7670 and similar). Data is sampled on the rising edge of PCLK
+    // while HREF is active; a VSYNC pulse marks the start of each frame.
+    // The camera must already be configured and clocked.
+    //
+    // Capture is done by polling, with each edge wait compiled to a
+    // tight bit-test loop and each byte read with a single port read.
+    // At 16 MHz, an AVR keeps up with a pixel clock of about 1 MHz
+    // (slow the camera down with its clock prescaler).
+    //
+    // Since interrupts are off during a frame, the edge waits are
+    // bounded by spin counts rather than micros(). If PCLK stops for
+    // pclk_spins polls, or HREF for href_spins, the capture is abandoned
+    // and capture_frame returns false.
+    //
+    // To fit a frame in a small SRAM, step keeps every step-th pixel of
+    // a line and line_step every line_step-th line. A pixel is
+    // bytes_per_pixel bytes (2 for RGB565 or YUV422); with YUV422 data,
+    // bytes_per_pixel=1 and step=2 keeps just the luminance.
+    public:
+        // the camera drives all its outputs, so no pullups are needed
+        ParallelCameraCapture() : pclk(false), href(false), vsync(false) {}
+
+        static const u16 pclk_spins = 0xFFFF;
+        static const u32 href_spins = 1000000;
+
+        boolean wait_frame(u32 timeout_us=1000000) {
+            // Wait for the start of a frame (the end of a VSYNC pulse).
+            // Returns false if no frame starts within the timeout.
+            u32 start = micros();
+            while(vsync != vsync_active) {
+                if(micros() - start > timeout_us) {
+                    return false;
+                }
+            }
+            while(vsync == vsync_active) {
+                if(micros() - start > timeout_us) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        boolean capture_line(u8* buffer, u16 pixels, u8 step=1) {
+            // Capture the next line. Stores pixels pixels, keeping one in
+            // every step, then waits for the rest of the line to finish.
+            // Returns false if the camera stops mid-line.
+            if(!wait_href(!href_active) || !wait_href(href_active)) {
+                return false;
+            }
+            boolean ok;
+            if(step == 1) {
+                ok = capture(buffer, pixels * bytes_per_pixel);
+            }
+            else {
+                ok = capture(buffer, pixels, step);
+            }
+            return ok && wait_href(!href_active);
+        }
+
+        boolean skip_line() {
+            return wait_href(!href_active) && wait_href(href_active) && wait_href(!href_active);
+        }
+
+        boolean capture_frame(u8* buffer, u16 pixels, u16 lines, u8 step=1, u8 line_step=1) {
+            // Capture a frame of pixels x lines into buffer, keeping one
+            // pixel in every step and one line in every line_step.
+            // Interrupts are disabled for the whole frame, since missing
+            // a single clock edge would misalign the rest of the image.
+            if(!wait_frame()) {
+                return false;
+            }
+            // The atomic block on ARM is a for loop, so finish it
+            // normally rather than returning from inside.
+            boolean ok = true;
+            atomic {
+                for(u16 y = 0; ok && y < lines; y++) {
+                    ok = capture_line(buffer, pixels, step);
+                    buffer += pixels * bytes_per_pixel;
+                    for(u8 i = 1; ok && i < line_step; i++) {
+                        ok = skip_line();
+                    }
+                }
+            }
+            return ok;
+        }
+
+    private:
+        inline boolean edge() {
+            // wait for a rising edge of PCLK
+            u16 spins = pclk_spins;
+            while(pclk) {
+                if(!--spins) {
+                    return false;
+                }
+            }
+            while(!pclk) {
+                if(!--spins) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        boolean wait_href(boolean level) {
+            u32 spins = href_spins;
+            while(href != level) {
+                if(!--spins) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        inline boolean capture(u8* p, u16 n) {
+            while(n--) {
+                if(!edge()) {
+                    return false;
+                }
+                *p++ = data.read();
+            }
+            return true;
+        }
+
+        inline boolean capture(u8* p, u16 pixels, u8 step) {
+            while(pixels--) {
+                for(u8 i = 0; i < bytes_per_pixel; i++) {
+                    if(!edge()) {
+                        return false;
+                    }
+                    *p++ = data.read();
+                }
+                for(u8 i = bytes_per_pixel; i < step * bytes_per_pixel; i++) {
+                    if(!edge()) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        data_port data;
+        Input<pclk_pin> pclk;
+        Input<href_pin> href;
+        Input<vsync_pin> vsync;
+};
@@ -0,0 +1,31 @@
+#include <DirectIO.h>
+#include "DirectIO_Camera.h"
+
+// An OV7670 camera on an Arduino Mega, configured for QQVGA (160x120)
+// YUV422 output with a slow pixel clock. D0-D7 are on port A
+// (pins 22-29), PCLK on pin 2, HREF on pin 3 and VSYNC on pin 4.
+//
+// Keeping only the luminance bytes (1 byte per pixel, every second
+// byte) and every second pixel and line gives an 80x60 grayscale image.
+ParallelCameraCapture<InputPort<PORT_A>, 2, 3, 4, 1> camera;
+
+const u16 width = 80;
+const u16 height = 60;
+u8 image[width * height];
+
+void setup() {
+  Serial.begin(115200);
+}
+
+void loop() {
+  // luminance is every 2nd byte; every 2nd pixel of that is every 4th byte
+  if(camera.capture_frame(image, width, height, 4, 2)) {
+    // send the frame as a binary PGM image
+    Serial.print("P5 80 60 255\n");
+    Serial.write(image, sizeof(image));
+  }
+  else {
+    Serial.println("no camera");
+  }
+  delay(1000);
+}
@@ -0,0 +1,282 @@
+/*
+  DirectIO_CharLCD.h - HD44780 character LCD driver using Direct IO library
+  Copyright (c) 2015-2018 Michael Marchetti.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <DirectIO.h>
+
+#if defined(DIRECTIO_FALLBACK)
+#error "CharLCD requires direct I/O support (AVR, SAM or SAMD boards)"
+#endif
+
+// HD44780 commands
+const u8 LCD_CLEAR = 0x01;
+const u8 LCD_HOME = 0x02;
+const u8 LCD_ENTRY_MODE = 0x04;         // | LCD_ENTRY_INCREMENT
+const u8 LCD_DISPLAY_CONTROL = 0x08;    // | LCD_DISPLAY_ON, LCD_CURSOR_ON, LCD_BLINK_ON
+const u8 LCD_FUNCTION_SET = 0x20;       // | LCD_8BIT, LCD_2LINE
+const u8 LCD_SET_CGRAM = 0x40;
+const u8 LCD_SET_DDRAM = 0x80;
+
+const u8 LCD_ENTRY_INCREMENT = 0x02;
+const u8 LCD_DISPLAY_ON = 0x04;
+const u8 LCD_CURSOR_ON = 0x02;
+const u8 LCD_BLINK_ON = 0x01;
+const u8 LCD_8BIT = 0x10;
+const u8 LCD_2LINE = 0x08;
+
+// Selects how CharLCD waits for the controller: by polling
+// the busy flag when the RW pin is connected, or by timing.
+struct _lcd_busy_flag {};
+struct _lcd_timed {};
+
+template <u8 rw_pin> struct _lcd_wait {
+    typedef _lcd_busy_flag type;
+};
+
+template <> struct _lcd_wait<NO_PIN> {
+    typedef _lcd_timed type;
+};
+
+template <class data_port, u8 rs_pin, u8 en_pin, u8 rw_pin=NO_PIN, u8 cols=16, u8 rows=2>
+class CharLCD : public Print {
+    // An HD44780 character LCD on a 4 or 8 bit data port. In 4 bit
+    // mode, the port is wired to D4-D7. Each nibble or byte is a
+    // single port write.
+    //
+    // If rw_pin is connected, data_port must be a BiDirectionalPort,
+    // and the busy flag is read back after each operation. Otherwise
+    // data_port can be an OutputPort and RW is tied low; each operation
+    // then records when the controller will be ready, so the wait only
+    // happens if another operation follows too soon.
+    //
+    // Text written with print() goes to a frame buffer; refresh()
+    // sends only the characters that changed since the last refresh.
+    public:
+        CharLCD() : col(0), row(0), address(0xFF), busy_start(0), busy_time(0) {}
+
+        void begin() {
+            // Initialize the display (see the HD44780 datasheet,
+            // "Initializing by Instruction"). The busy flag can't be
+            // checked until the interface width has been set.
+            make_output(wait_type());
+            delay(50);
+            if(data_port::width == 4) {
+                write_bus(0x03);
+                delayMicroseconds(4500);
+                write_bus(0x03);
+                delayMicroseconds(150);
+                write_bus(0x03);
+                delayMicroseconds(150);
+                write_bus(0x02);
+                delayMicroseconds(150);
+                command(LCD_FUNCTION_SET | (rows > 1 ? LCD_2LINE : 0));
+            }
+            else {
+                write_bus(0x30);
+                delayMicroseconds(4500);
+                write_bus(0x30);
+                delayMicroseconds(150);
+                write_bus(0x30);
+                delayMicroseconds(150);
+                command(LCD_FUNCTION_SET | LCD_8BIT | (rows > 1 ? LCD_2LINE : 0));
+            }
+            command(LCD_DISPLAY_CONTROL | LCD_DISPLAY_ON);
+            command(LCD_ENTRY_MODE | LCD_ENTRY_INCREMENT);
+            command(LCD_CLEAR);
+
+            for(u16 i = 0; i < cols * rows; i++) {
+                frame[i] = ' ';
+            }
+            col = 0;
+            row = 0;
+            address = 0;
+        }
+
+        void command(u8 value) {
+            // Send a command byte to the controller.
+            send(value, LOW);
+            if(value == LCD_CLEAR || value == LCD_HOME) {
+                busy(2000);
+                address = 0;
+                if(value == LCD_CLEAR) {
+                    // the display is blank, so refresh() must redraw it all
+                    for(u16 i = 0; i < cols * rows; i++) {
+                        shown[i] = ' ';
+                    }
+                }
+            }
+            else {
+                busy(53);
+                if(value & (LCD_SET_DDRAM | LCD_SET_CGRAM)) {
+                    // the cursor address is no longer known
+                    address = 0xFF;
+                }
+            }
+        }
+
+        void create_char(u8 index, const u8 pattern[8]) {
+            // Define custom character index (0-7) from 8 rows of 5 bits.
+            command(LCD_SET_CGRAM | (index << 3));
+            for(u8 i = 0; i < 8; i++) {
+                send(pattern[i], HIGH);
+                busy(53);
+            }
+        }
+
+        void clear() {
+            // Blank the frame buffer and move to the top left.
+            for(u16 i = 0; i < cols * rows; i++) {
+                frame[i] = ' ';
+            }
+            col = 0;
+            row = 0;
+        }
+
+        void set_cursor(u8 c, u8 r) {
+            col = c;
+            row = r;
+        }
+
+        virtual size_t write(uint8_t c) {
+            // Put a character in the frame buffer at the cursor.
+            // Newline moves to the start of the next row.
+            if(c == '\n') {
+                col = 0;
+                row++;
+            }
+            else if(c != '\r') {
+                if(col < cols && row < rows) {
+                    frame[row * cols + col] = c;
+                }
+                col++;
+            }
+            return 1;
+        }
+
+        using Print::write;
+
+        void refresh() {
+            // Send the characters that changed since the last refresh.
+            // The display's address counter advances after each
+            // character, so runs of changes need no extra commands.
+            for(u8 r = 0; r < rows; r++) {
+                for(u8 c = 0; c < cols; c++) {
+                    u16 i = r * cols + c;
+                    if(frame[i] == shown[i]) {
+                        continue;
+                    }
+                    u8 a = row_address(r) + c;
+                    if(a != address) {
+                        send(LCD_SET_DDRAM | a, LOW);
+                        busy(53);
+                    }
+                    send(frame[i], HIGH);
+                    busy(53);
+                    shown[i] = frame[i];
+                    address = a + 1;
+                }
+            }
+        }
+
+    private:
+        typedef typename _lcd_wait<rw_pin>::type wait_type;
+
+        static u8 row_address(u8 r) {
+            // rows 2 and 3 continue rows 0 and 1 in display RAM
+            return ((r & 1) ? 0x40 : 0x00) + ((r & 2) ? cols : 0);
+        }
+
+        void write_bus(u8 value) {
+            // Latch one nibble or byte on the falling edge of E
+            // (address setup 60ns, E pulse 450ns, cycle 1000ns).
+            delay_ns<60>();
+            en = HIGH;
+            data.write(value);
+            delay_ns<450>();
+            en = LOW;
+            delay_ns<550>();
+        }
+
+        void send(u8 value, boolean data_register) {
+            wait_ready(wait_type());
+            rs = data_register;
+            if(data_port::width == 4) {
+                write_bus(value >> 4);
+                write_bus(value & 0x0F);
+            }
+            else {
+                write_bus(value);
+            }
+        }
+
+        void busy(u16 us) {
+            // the controller will be busy for this long (ignored
+            // when the busy flag is used)
+            busy_start = micros();
+            busy_time = us;
+        }
+
+        void make_output(_lcd_timed) {}
+
+        void make_output(_lcd_busy_flag) {
+            rw = LOW;
+            data.make_output();
+        }
+
+        void wait_ready(_lcd_timed) {
+            while(micros() - busy_start < busy_time) {}
+        }
+
+        void wait_ready(_lcd_busy_flag) {
+            // Read the status register until the busy flag (D7) clears.
+            // Gives up after 5ms, in case no display is connected.
+            u32 start = micros();
+            u8 status;
+
+            rs = LOW;
+            data.make_input();
+            rw = HIGH;
+            do {
+                status = data.template read_strobed<450>(en, HIGH);
+                delay_ns<550>();
+                if(data_port::width == 4) {
+                    status <<= 4;
+
+                    // the low nibble (address counter) must be read too
+                    data.template read_strobed<450>(en, HIGH);
+                    delay_ns<550>();
+                }
+            } while((status & 0x80) && micros() - start < 5000);
+            make_output(wait_type());
+        }
+
+        static_assert(data_port::width == 4 || data_port::width == 8, "CharLCD needs a 4 or 8 bit data port");
+
+        data_port data;
+        Output<rs_pin> rs;
+        Output<en_pin> en;
+        Output<rw_pin> rw;
+
+        char frame[cols * rows];
+        char shown[cols * rows];
+        u8 col;
+        u8 row;
+        u8 address;     // display RAM address counter, or 0xFF if unknown
+        u32 busy_start;
+        u16 busy_time;
+};
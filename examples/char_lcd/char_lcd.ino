@@ -0,0 +1,24 @@
+#include <DirectIO.h>
+#include "DirectIO_CharLCD.h"
+
+// A 16x2 HD44780 display in 4 bit mode, with D4-D7 on
+// port D bits 4-7 (pins 4-7 on an Uno), RS on pin 8, E on pin 9
+// and RW on pin 10. Since RW is connected, the busy flag is used.
+CharLCD<BiDirectionalPort<PORT_D, 4, 4>, 8, 9, 10> lcd;
+
+// Without RW (tied to ground), an OutputPort is enough:
+// CharLCD<OutputPort<PORT_D, 4, 4>, 8, 9> lcd;
+
+void setup() {
+  lcd.begin();
+  lcd.print("Uptime");
+}
+
+void loop() {
+  // only the changed digits are sent to the display
+  lcd.set_cursor(0, 1);
+  lcd.print(millis() / 1000);
+  lcd.print(" s");
+  lcd.refresh();
+  delay(100);
+}
@@ -0,0 +1,140 @@
+/*
+  DirectIO_Charlieplex.h - Charlieplexed LED driver using Direct IO library
+  Copyright (c) 2015-2018 Michael Marchetti.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <DirectIO.h>
+
+#if defined(DIRECTIO_FALLBACK)
+#error "Charlieplex requires direct I/O support (AVR, SAM or SAMD boards)"
+#endif
+
+template <class port, u8 start_bit=0, u8 npins=8, u8 depth=4>
+class Charlieplex {
+    // Drives npins * (npins - 1) LEDs from npins pins of one port.
+    // There is an LED for each ordered pair of pins: LED i has its
+    // anode on pin i / (npins - 1), and its cathode on the i % (npins - 1)th
+    // of the other pins, counting up from bit 0.
+    //
+    // The LEDs are refreshed one anode pin at a time: that pin drives
+    // HIGH, the cathodes of the lit LEDs drive LOW, and all other pins
+    // are inputs (high impedance, no pullup). The direction register
+    // value for each anode and brightness bit is kept up to date by
+    // set(), so each refresh step is just two port stores on AVR.
+    //
+    // Brightness uses binary code modulation with depth bits. Call
+    // tick() from a timer interrupt; it shows the next step and returns
+    // that step's display time, in units of the shortest one. The timer
+    // period should be set to that many units before the next call.
+    public:
+        static const u8 leds = npins * (npins - 1);
+
+        Charlieplex() : anode(0), plane(0) {
+            for(u8 a = 0; a < npins; a++) {
+                for(u8 p = 0; p < depth; p++) {
+                    dir[a][p] = pin_mask(a);
+                }
+            }
+        }
+
+        void setup() {
+            // all pins inputs, with the output latches (and pullups) off
+            port::port_enable_outputs(mask);
+            port::port_output_clear(mask);
+            port::port_make_inputs(mask);
+        }
+
+        void set(u8 led, u8 brightness) {
+            // Set an LED's brightness (0-255); the top depth bits are used.
+            if(led >= leds) {
+                return;
+            }
+            u8 a = led / (npins - 1);
+            u8 c = led % (npins - 1);
+            if(c >= a) {
+                c++;
+            }
+            set(a, c, brightness);
+        }
+
+        void set(u8 anode_pin, u8 cathode_pin, u8 brightness) {
+            // Set the LED between two of the pins (numbered from 0).
+            port_data_t b = pin_mask(cathode_pin);
+            for(u8 p = 0; p < depth; p++) {
+                if((brightness >> (8 - depth + p)) & 1) {
+                    dir[anode_pin][p] |= b;
+                }
+                else {
+                    dir[anode_pin][p] &= ~b;
+                }
+            }
+        }
+
+        void clear() {
+            for(u8 a = 0; a < npins; a++) {
+                for(u8 p = 0; p < depth; p++) {
+                    dir[a][p] = pin_mask(a);
+                }
+            }
+        }
+
+        u8 tick() {
+            u8 shown = plane;
+            apply(dir[anode][plane], pin_mask(anode));
+            if(++plane == depth) {
+                plane = 0;
+                if(++anode == npins) {
+                    anode = 0;
+                }
+            }
+            return 1 << shown;
+        }
+
+    private:
+        static const port_data_t mask = ((port_data_t(1) << npins) - 1) << start_bit;
+
+        static inline port_data_t pin_mask(u8 pin) {
+            return port_data_t(1) << (start_bit + pin);
+        }
+
+#if defined(ARDUINO_ARCH_AVR)
+        static inline void apply(port_data_t d, port_data_t o) {
+            // the other bits of the port are kept as they are
+            if(mask == port_data_t(-1)) {
+                *port_t(port::out) = o;
+                *port_t(port::dir) = d;
+            }
+            else {
+                *port_t(port::out) = (*port_t(port::out) & ~mask) | o;
+                *port_t(port::dir) = (*port_t(port::dir) & ~mask) | d;
+            }
+        }
+#else
+        static inline void apply(port_data_t d, port_data_t o) {
+            port::port_make_inputs(mask & ~d);
+            port::port_output_clear(mask & ~o);
+            port::port_output_set(o);
+            port::port_make_outputs(d);
+        }
+#endif
+
+        static_assert(npins >= 2 && start_bit + npins <= 8 * sizeof(port_data_t), "Charlieplex pins must be within one port");
+
+        volatile port_data_t dir[npins][depth];
+        u8 anode;
+        u8 plane;
+};
@@ -0,0 +1,38 @@
+#include <DirectIO.h>
+#include "DirectIO_Charlieplex.h"
+
+// 20 charlieplexed LEDs on port B bits 0-4 (pins 8-12 on an Uno),
+// each pair of pins joined by two LEDs in opposite directions
+// (with a current limiting resistor on each pin), with 4 bit brightness.
+Charlieplex<PORT_B, 0, 5> leds;
+
+// Shortest step display time, in CPU cycles. A full refresh takes
+// 5 pins * 15 units (about 4.8 ms, or 200 Hz at 16 MHz).
+const u16 unit = 1024;
+
+void setup() {
+  leds.setup();
+
+  // Timer1 in CTC mode, no prescaler
+  noInterrupts();
+  TCCR1A = 0;
+  TCCR1B = _BV(WGM12) | _BV(CS10);
+  OCR1A = unit - 1;
+  TIMSK1 = _BV(OCIE1A);
+  interrupts();
+}
+
+ISR(TIMER1_COMPA_vect) {
+  OCR1A = leds.tick() * unit - 1;
+}
+
+void loop() {
+  // a brightness wave moving along the LEDs
+  static u8 phase = 0;
+  for(u8 i = 0; i < leds.leds; i++) {
+    u8 x = phase + i * 12;
+    leds.set(i, (x < 128) ? x * 2 : (255 - x) * 2);
+  }
+  phase++;
+  delay(10);
+}
@@ -0,0 +1,49 @@
+#include <DirectIO.h>
+
+// Debounce 6 buttons on port D bits 2-7 (pins 2-7 on an Uno) and
+// 2 more on pins 9 and 12, each wired to ground (so active LOW).
+// All buttons are sampled every millisecond from a Timer1 interrupt,
+// and change state after 4 samples in a row.
+DebouncedPort<InputPort<PORT_D, 2, 6>, 4, LOW> buttons;
+DebouncedPort<InputGroup<9, 12>, 4, LOW> extra;
+
+void setup() {
+  Serial.begin(115200);
+
+  // InputPort doesn't enable pullups; turn them on for pins 2-7
+  for(u8 pin = 2; pin <= 7; pin++) {
+    pinMode(pin, INPUT_PULLUP);
+  }
+  buttons.setup();
+  extra.setup();
+
+  // Timer1 in CTC mode, interrupting every millisecond
+  noInterrupts();
+  TCCR1A = 0;
+  TCCR1B = _BV(WGM12) | _BV(CS10);
+  OCR1A = F_CPU / 1000 - 1;
+  TIMSK1 = _BV(OCIE1A);
+  interrupts();
+}
+
+ISR(TIMER1_COMPA_vect) {
+  buttons.tick();
+  extra.tick();
+}
+
+void loop() {
+  u8 down = buttons.pressed();
+  u8 up = buttons.released();
+  if(down) {
+    Serial.print("pressed: ");
+    Serial.println(down, BIN);
+  }
+  if(up) {
+    Serial.print("released: ");
+    Serial.println(up, BIN);
+  }
+
+  if(extra.pressed() & 0x01) {
+    Serial.println("pin 9 pressed");
+  }
+}
@@ -0,0 +1,408 @@
+/*
+  DirectIO_DebugProbe.h - Bit-banged JTAG and SWD hosts using Direct IO library
+  Copyright (c) 2015-2018 Michael Marchetti.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <DirectIO.h>
+
+#if defined(DIRECTIO_FALLBACK)
+#error "JtagHost and SwdHost require direct I/O support (AVR, SAM or SAMD boards)"
+#endif
+
+// Unrolled LSB-first shifts of bits i to n - 1 of a value. These are
+// expanded at compile time, so each bit's shift and mask is a constant.
+template <u8 i, u8 n>
+struct _lsb_shift {
+    // clock each bit out and the reply in at the same time (JTAG)
+    template <class host_t>
+    static inline void run(host_t& host, u32 out, u32& in) {
+        if(host.clock_bit((out >> i) & 1)) {
+            in |= u32(1) << i;
+        }
+        _lsb_shift<i + 1, n>::run(host, out, in);
+    }
+
+    // clock bits out only, or in only (SWD)
+    template <class host_t>
+    static inline void write(host_t& host, u32 out) {
+        host.write_bit((out >> i) & 1);
+        _lsb_shift<i + 1, n>::write(host, out);
+    }
+
+    template <class host_t>
+    static inline void read(host_t& host, u32& in) {
+        if(host.read_bit()) {
+            in |= u32(1) << i;
+        }
+        _lsb_shift<i + 1, n>::read(host, in);
+    }
+};
+
+template <u8 n>
+struct _lsb_shift<n, n> {
+    template <class host_t>
+    static inline void run(host_t&, u32, u32&) {}
+    template <class host_t>
+    static inline void write(host_t&, u32) {}
+    template <class host_t>
+    static inline void read(host_t&, u32&) {}
+};
+
+template <u8 tck_pin, u8 tms_pin, u8 tdi_pin, u8 tdo_pin, u32 half_period_ns=0>
+class JtagHost {
+    // A JTAG host. The TAP is kept in Run-Test/Idle between scans.
+    // ir<bits>() and dr<bits>() do a complete IR or DR scan, with the
+    // shift unrolled at compile time, and return the bits shifted out.
+    // write_dr() shifts a block of bytes in one DR scan, for bulk
+    // transfers such as flash page loads.
+    //
+    // TDI and TMS change while TCK is low and the target samples them
+    // on the rising edge; TDO is read before the rising edge. With
+    // half_period_ns = 0, TCK runs as fast as the pins can be written.
+    public:
+        JtagHost() : tck(LOW), tms(HIGH), tdi(HIGH), tdo(false) {}
+
+        void reset() {
+            // five clocks with TMS high reach Test-Logic-Reset from any
+            // state; then go to Run-Test/Idle
+            for(u8 i = 0; i < 5; i++) {
+                clock_bit(HIGH, HIGH);
+            }
+            clock_bit(HIGH, LOW);
+        }
+
+        void idle(u16 clocks) {
+            // stay in Run-Test/Idle for some clocks
+            while(clocks--) {
+                clock_bit(HIGH, LOW);
+            }
+        }
+
+        template <u8 bits>
+        u32 ir(u32 value) {
+            // Select-DR, Select-IR, Capture-IR, Shift-IR
+            clock_bit(HIGH, HIGH);
+            clock_bit(HIGH, HIGH);
+            clock_bit(HIGH, LOW);
+            clock_bit(HIGH, LOW);
+            return shift<bits>(value);
+        }
+
+        template <u8 bits>
+        u32 dr(u32 value) {
+            // Select-DR, Capture-DR, Shift-DR
+            clock_bit(HIGH, HIGH);
+            clock_bit(HIGH, LOW);
+            clock_bit(HIGH, LOW);
+            return shift<bits>(value);
+        }
+
+        void write_dr(const u8* data, u32 bytes) {
+            // shift bytes, LSB first, in one DR scan
+            if(bytes == 0) {
+                return;
+            }
+            clock_bit(HIGH, HIGH);
+            clock_bit(HIGH, LOW);
+            clock_bit(HIGH, LOW);
+            u32 in = 0;
+            while(--bytes) {
+                _lsb_shift<0, 8>::run(*this, *data++, in);
+            }
+            shift<8>(*data);
+        }
+
+        boolean clock_bit(boolean tdi_value, boolean tms_value=LOW) {
+            // one TCK cycle; returns TDO
+            tdi = tdi_value;
+            tms = tms_value;
+            delay_ns<half_period_ns>();
+            boolean value = tdo;
+            tck = HIGH;
+            delay_ns<half_period_ns>();
+            tck = LOW;
+            return value;
+        }
+
+    private:
+        template <u8 bits>
+        u32 shift(u32 value) {
+            // In Shift-IR or Shift-DR: shift all but the last bit,
+            // then the last one with TMS high (Exit1), then go
+            // through Update to Run-Test/Idle.
+            u32 in = 0;
+            _lsb_shift<0, bits - 1>::run(*this, value, in);
+            if(clock_bit((value >> (bits - 1)) & 1, HIGH)) {
+                in |= u32(1) << (bits - 1);
+            }
+            clock_bit(HIGH, HIGH);
+            clock_bit(HIGH, LOW);
+            return in;
+        }
+
+        Output<tck_pin> tck;
+        Output<tms_pin> tms;
+        Output<tdi_pin> tdi;
+        Input<tdo_pin> tdo;
+};
+
+// SWD acknowledgements, and an error for a bad parity bit on a read
+const u8 SWD_OK = 1;
+const u8 SWD_WAIT = 2;
+const u8 SWD_FAULT = 4;
+const u8 SWD_PARITY_ERROR = 8;
+
+// debug port registers (bank 0)
+const u8 SWD_DP_IDCODE = 0x0;
+const u8 SWD_DP_ABORT = 0x0;
+const u8 SWD_DP_CTRL_STAT = 0x4;
+const u8 SWD_DP_SELECT = 0x8;
+const u8 SWD_DP_RDBUFF = 0xC;
+
+// CTRL/STAT sticky error flags: WDATAERR, STICKYERR, STICKYCMP, STICKYORUN
+const u32 SWD_STICKY_ERRORS = 0xB2;
+
+// MEM-AP registers
+const u8 SWD_AP_CSW = 0x0;
+const u8 SWD_AP_TAR = 0x4;
+const u8 SWD_AP_DRW = 0xC;
+
+template <u8 swclk_pin, u8 swdio_pin, u32 half_period_ns=0>
+class SwdHost {
+    // An ARM Serial Wire Debug host. transfer() sends one request
+    // packet and its data, with the 32 bit data phase unrolled at
+    // compile time, and returns the target's acknowledgement (retrying
+    // while it answers WAIT). read_mem() and write_mem() move blocks of
+    // words through the memory access port (AP 0) with an
+    // auto-incrementing address, re-sending the address at each 1 KB
+    // boundary, where the increment wraps.
+    //
+    // The host writes SWDIO while SWCLK is low and the target samples
+    // it on the rising edge; the target drives SWDIO after the rising
+    // edge and the host reads it while SWCLK is low.
+    public:
+        SwdHost() : swclk(HIGH) {
+            swdio.write(HIGH);
+            swdio.make_output();
+        }
+
+        u8 connect(u32& idcode) {
+            // Switch an SWJ-DP from JTAG to SWD, then read its IDCODE,
+            // which also clears the line reset state.
+            line_reset();
+            _lsb_shift<0, 16>::write(*this, 0xE79E);
+            line_reset();
+            idle(2);
+            return read_dp(SWD_DP_IDCODE, idcode);
+        }
+
+        u8 power_up() {
+            // clear any sticky errors, and power up the debug
+            // and system domains
+            u8 ack = write_dp(SWD_DP_ABORT, 0x1E);
+            if(ack != SWD_OK) {
+                return ack;
+            }
+            ack = write_dp(SWD_DP_CTRL_STAT, 0x50000000);
+            u32 status = 0;
+            for(u8 i = 0; i < 100 && ack == SWD_OK && (status & 0xA0000000) != 0xA0000000; i++) {
+                ack = read_dp(SWD_DP_CTRL_STAT, status);
+            }
+            if(ack == SWD_OK && (status & 0xA0000000) != 0xA0000000) {
+                // the power up requests were never acknowledged
+                return SWD_FAULT;
+            }
+            return ack;
+        }
+
+        u8 read_dp(u8 address, u32& value) {
+            return transfer(false, true, address, value);
+        }
+
+        u8 write_dp(u8 address, u32 value) {
+            return transfer(false, false, address, value);
+        }
+
+        u8 read_ap(u8 address, u32& value) {
+            // AP reads are posted: this returns the result of the
+            // previous AP read (read SWD_DP_RDBUFF for the last one)
+            return transfer(true, true, address, value);
+        }
+
+        u8 write_ap(u8 address, u32 value) {
+            return transfer(true, false, address, value);
+        }
+
+        u8 write_mem(u32 address, const u32* words, u32 count) {
+            // write words to word-aligned target memory
+            u8 ack = start_mem();
+            while(ack == SWD_OK && count) {
+                ack = write_ap(SWD_AP_TAR, address);
+                u32 n = block(address, count);
+                while(ack == SWD_OK && n--) {
+                    ack = write_ap(SWD_AP_DRW, *words++);
+                    address += 4;
+                    count--;
+                }
+            }
+            idle(8);
+            if(ack == SWD_OK) {
+                // the last write is posted: check it finished
+                // without setting a sticky error
+                u32 status;
+                ack = read_dp(SWD_DP_CTRL_STAT, status);
+                if(ack == SWD_OK && (status & SWD_STICKY_ERRORS)) {
+                    ack = SWD_FAULT;
+                }
+            }
+            return ack;
+        }
+
+        u8 read_mem(u32 address, u32* words, u32 count) {
+            // read words from word-aligned target memory
+            u8 ack = start_mem();
+            u32 value;
+            while(ack == SWD_OK && count) {
+                ack = write_ap(SWD_AP_TAR, address);
+                u32 n = block(address, count);
+                if(ack == SWD_OK) {
+                    // the first read only starts the transfer
+                    ack = read_ap(SWD_AP_DRW, value);
+                }
+                while(ack == SWD_OK && --n) {
+                    ack = read_ap(SWD_AP_DRW, *words++);
+                    address += 4;
+                    count--;
+                }
+                if(ack == SWD_OK) {
+                    ack = read_dp(SWD_DP_RDBUFF, *words++);
+                    address += 4;
+                    count--;
+                }
+            }
+            return ack;
+        }
+
+        u8 transfer(boolean ap, boolean read, u8 address, u32& value) {
+            u8 ack;
+            for(u8 retry = 0; retry < 100; retry++) {
+                ack = packet(ap, read, address, value);
+                if(ack != SWD_WAIT) {
+                    break;
+                }
+            }
+            return ack;
+        }
+
+        void line_reset() {
+            // at least 50 clocks with SWDIO high
+            for(u8 i = 0; i < 56; i++) {
+                write_bit(HIGH);
+            }
+        }
+
+        void idle(u8 clocks) {
+            while(clocks--) {
+                write_bit(LOW);
+            }
+        }
+
+        void write_bit(boolean value) {
+            swclk = LOW;
+            swdio = value;
+            delay_ns<half_period_ns>();
+            swclk = HIGH;
+            delay_ns<half_period_ns>();
+        }
+
+        boolean read_bit() {
+            swclk = LOW;
+            delay_ns<half_period_ns>();
+            boolean value = swdio;
+            swclk = HIGH;
+            delay_ns<half_period_ns>();
+            return value;
+        }
+
+    private:
+        static boolean parity(u32 value) {
+            value ^= value >> 16;
+            value ^= value >> 8;
+            value ^= value >> 4;
+            value ^= value >> 2;
+            value ^= value >> 1;
+            return value & 1;
+        }
+
+        static u32 block(u32 address, u32 count) {
+            // words until the end of the 1 KB block, or count
+            u32 n = (0x400 - (address & 0x3FF)) / 4;
+            return (n < count) ? n : count;
+        }
+
+        u8 start_mem() {
+            // AP 0, bank 0; 32 bit accesses with auto-increment
+            u8 ack = write_dp(SWD_DP_SELECT, 0);
+            if(ack == SWD_OK) {
+                ack = write_ap(SWD_AP_CSW, 0x23000012);
+            }
+            return ack;
+        }
+
+        void turnaround() {
+            swclk = LOW;
+            delay_ns<half_period_ns>();
+            swclk = HIGH;
+            delay_ns<half_period_ns>();
+        }
+
+        u8 packet(boolean ap, boolean read, u8 address, u32& value) {
+            // start, APnDP, RnW, A[3:2], parity, stop, park
+            u8 request = 0x81 | (ap << 1) | (read << 2) | ((address & 0xC) << 1);
+            request |= parity(request & 0x1E) << 5;
+            _lsb_shift<0, 8>::write(*this, request);
+
+            swdio.make_input();
+            turnaround();
+            u32 ack = 0;
+            _lsb_shift<0, 3>::read(*this, ack);
+
+            if(ack == SWD_OK && read) {
+                u32 data = 0;
+                _lsb_shift<0, 32>::read(*this, data);
+                boolean p = read_bit();
+                turnaround();
+                swdio.make_output();
+                if(p != parity(data)) {
+                    return SWD_PARITY_ERROR;
+                }
+                value = data;
+                return SWD_OK;
+            }
+
+            turnaround();
+            swdio.make_output();
+            if(ack == SWD_OK) {
+                _lsb_shift<0, 32>::write(*this, value);
+                write_bit(parity(value));
+            }
+            return ack;
+        }
+
+        Output<swclk_pin> swclk;
+        BiDirectional<swdio_pin> swdio;
+};
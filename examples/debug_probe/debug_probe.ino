@@ -0,0 +1,63 @@
+#include <DirectIO.h>
+#include "DirectIO_DebugProbe.h"
+
+// An SWD target on pins 2 (SWCLK) and 3 (SWDIO), and a JTAG target on
+// pins 4 (TCK), 5 (TMS), 6 (TDI) and 7 (TDO). Most targets run at 3.3V:
+// use level shifters, or a 3.3V board.
+SwdHost<2, 3> swd;
+JtagHost<4, 5, 6, 7> jtag;
+
+// a block of target SRAM (0x20000000 on most Cortex-M parts)
+const u32 ram = 0x20000000;
+const u16 words = 64;
+u32 buffer[words];
+
+void setup() {
+  Serial.begin(115200);
+
+  jtag.reset();
+  Serial.print("JTAG IDCODE: ");
+  Serial.println(jtag.dr<32>(0), HEX);
+
+  u32 idcode;
+  if(swd.connect(idcode) != SWD_OK || swd.power_up() != SWD_OK) {
+    Serial.println("No SWD target");
+    return;
+  }
+  Serial.print("SWD DPIDR: ");
+  Serial.println(idcode, HEX);
+
+  u32 cpuid;
+  swd.read_mem(0xE000ED00, &cpuid, 1);
+  Serial.print("CPUID: ");
+  Serial.println(cpuid, HEX);
+
+  for(u16 i = 0; i < words; i++) {
+    buffer[i] = 0x01010101UL * i;
+  }
+  u32 start = micros();
+  u8 ack = swd.write_mem(ram, buffer, words);
+  u32 elapsed = micros() - start;
+  Serial.print("Wrote ");
+  Serial.print(words * 4);
+  Serial.print(" bytes in ");
+  Serial.print(elapsed);
+  Serial.print(" us, ack ");
+  Serial.println(ack);
+
+  for(u16 i = 0; i < words; i++) {
+    buffer[i] = 0;
+  }
+  swd.read_mem(ram, buffer, words);
+  u16 errors = 0;
+  for(u16 i = 0; i < words; i++) {
+    if(buffer[i] != 0x01010101UL * i) {
+      errors++;
+    }
+  }
+  Serial.print("Verify errors: ");
+  Serial.println(errors);
+}
+
+void loop() {
+}
@@ -0,0 +1,140 @@
+/*
+  DirectIO_Hub75.h - HUB75 RGB LED matrix driver using Direct IO library
+  Copyright (c) 2015-2018 Michael Marchetti.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <DirectIO.h>
+
+#if defined(DIRECTIO_FALLBACK)
+#error "Hub75Panel requires direct I/O support (AVR, SAM or SAMD boards)"
+#endif
+
+template <class rgb_port, class addr_port, u8 clk_pin, u8 lat_pin, u8 oe_pin,
+          u8 width=64, u8 height=32, u8 depth=4>
+class Hub75Panel {
+    // Refreshes a HUB75 RGB LED matrix using binary code modulation.
+    // rgb_port carries R1, G1, B1, R2, G2, B2 (in that bit order), so each
+    // column of the upper and lower halves is shifted in with one port
+    // store. addr_port selects the scan row (A, B, C, ...).
+    //
+    // The frame buffer is stored as bit planes: for each color bit,
+    // scan row and column, the 6 color bits to shift out. Call tick()
+    // from a timer interrupt. Each call latches the data shifted by the
+    // previous call, then shifts the next plane while this one is shown.
+    // tick() returns the display time of the plane now shown, in units
+    // of the shortest one; the timer period should be set to that many
+    // units before the next call. The unit must be longer than tick()
+    // takes to run.
+    public:
+        static const u8 scan_rows = height / 2;
+
+        Hub75Panel() : row(0), plane(0), next_row(0), next_plane(0), oe(HIGH) {
+            clear();
+        }
+
+        void clear() {
+            for(u8 p = 0; p < depth; p++) {
+                for(u8 r = 0; r < scan_rows; r++) {
+                    for(u8 x = 0; x < width; x++) {
+                        planes[p][r][x] = 0;
+                    }
+                }
+            }
+        }
+
+        void set_pixel(u8 x, u8 y, u8 red, u8 green, u8 blue) {
+            // Set a pixel from 8 bit color values;
+            // the top depth bits of each are used.
+            if(x >= width || y >= height) {
+                return;
+            }
+
+            u8 shift = (y < scan_rows) ? 0 : 3;
+            u8 r = (y < scan_rows) ? y : y - scan_rows;
+            u8 keep = ~(0x07 << shift);
+
+            for(u8 p = 0; p < depth; p++) {
+                u8 bit = 8 - depth + p;
+                u8 color = ((red >> bit) & 1) | (((green >> bit) & 1) << 1) | (((blue >> bit) & 1) << 2);
+                u8& v = planes[p][r][x];
+                v = (v & keep) | (color << shift);
+            }
+        }
+
+        u8 tick() {
+            // blank, latch and select the row that was shifted in
+            oe = HIGH;
+            lat = HIGH;
+            lat = LOW;
+            if(next_row != row) {
+                row = next_row;
+                addr = row;
+            }
+            plane = next_plane;
+            oe = LOW;
+
+            if(++next_plane == depth) {
+                next_plane = 0;
+                if(++next_row == scan_rows) {
+                    next_row = 0;
+                }
+            }
+            shift(planes[next_plane][next_row]);
+            return 1 << plane;
+        }
+
+    private:
+        static const port_data_t mask = port_data_t(0x3F) << rgb_port::first_bit;
+        typedef typename rgb_port::port_type port;
+
+#if defined(ARDUINO_ARCH_AVR)
+        inline void shift(const u8* p) {
+            // the other bits of the port are kept as they are
+            u8 other = *port_t(port::out) & ~mask;
+            for(u8 x = 0; x < width; x++) {
+                *port_t(port::out) = other | (*p++ << rgb_port::first_bit);
+                clk = HIGH;
+                clk = LOW;
+            }
+        }
+#else
+        inline void shift(const u8* p) {
+            for(u8 x = 0; x < width; x++) {
+                port_data_t v = port_data_t(*p++) << rgb_port::first_bit;
+                port::port_output_set(v);
+                port::port_output_clear(~v & mask);
+                clk = HIGH;
+                clk = LOW;
+            }
+        }
+#endif
+
+        static_assert(rgb_port::width >= 6, "Hub75Panel needs 6 bits of rgb_port");
+        static_assert((1 << addr_port::width) >= scan_rows, "addr_port is too narrow for this panel height");
+
+        u8 planes[depth][scan_rows][width];
+        u8 row;
+        u8 plane;
+        u8 next_row;
+        u8 next_plane;
+
+        rgb_port rgb;
+        addr_port addr;
+        Output<clk_pin> clk;
+        Output<lat_pin> lat;
+        Output<oe_pin> oe;
+};
@@ -0,0 +1,36 @@
+#include <DirectIO.h>
+#include "DirectIO_Hub75.h"
+
+// A 64x32 HUB75 panel on an Arduino Mega, with 4 bits per color.
+// R1, G1, B1, R2, G2, B2 are on port A bits 0-5 (pins 22-27),
+// row address A-D on port F bits 0-3 (pins A0-A3),
+// CLK on pin 11, LAT on pin 10 and OE on pin 9.
+typedef Hub75Panel<OutputPort<PORT_A, 0, 6>, OutputPort<PORT_F, 0, 4>, 11, 10, 9> Panel;
+Panel panel;
+
+// Shortest plane display time, in CPU cycles.
+// Must be longer than one tick() (about 700 cycles for 64 columns).
+const u16 unit = 1024;
+
+void setup() {
+  for(u8 y = 0; y < 32; y++) {
+    for(u8 x = 0; x < 64; x++) {
+      panel.set_pixel(x, y, x * 4, y * 8, 255 - x * 4);
+    }
+  }
+
+  // Timer1 in CTC mode, no prescaler
+  noInterrupts();
+  TCCR1A = 0;
+  TCCR1B = _BV(WGM12) | _BV(CS10);
+  OCR1A = unit - 1;
+  TIMSK1 = _BV(OCIE1A);
+  interrupts();
+}
+
+ISR(TIMER1_COMPA_vect) {
+  OCR1A = panel.tick() * unit - 1;
+}
+
+void loop() {
+}
@@ -0,0 +1,147 @@
+/*
+  DirectIO_KeyMatrix.h - Key matrix scanner using Direct IO library
+  Copyright (c) 2015-2018 Michael Marchetti.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <DirectIO.h>
+
+#if defined(DIRECTIO_FALLBACK)
+#error "KeyMatrix requires direct I/O support (AVR, SAM or SAMD boards)"
+#endif
+
+// set in an event from KeyMatrix::read() when the key was released
+const u8 KEY_RELEASED = 0x80;
+
+template <class row_port, class col_port, u16 settle_cycles=16, u8 samples=4, u8 buffer_size=16>
+class KeyMatrix {
+    // Scans a matrix of keys: each row is driven LOW in turn with one
+    // write to row_port, and after settle_cycles CPU cycles all columns
+    // are read with one read of col_port. The columns need pullups, and
+    // each key needs a diode (cathode to the row) for keys pressed
+    // together to be told apart (n-key rollover).
+    //
+    // Call scan() at a fixed rate, e.g. from a 1 kHz timer interrupt.
+    // Each row is debounced with a VerticalCounter, so a key changes
+    // state after reading the other way for samples scans in a row.
+    // Key changes are queued as events: the key number
+    // (row * columns + column), with KEY_RELEASED set for a release.
+    public:
+        static const u8 rows = row_port::width;
+        static const u8 columns = col_port::width;
+        typedef bits_type(columns) cols_t;
+
+        KeyMatrix() : head(0), tail(0), overruns(0) {
+            for(u8 r = 0; r < rows; r++) {
+                state[r] = 0;
+            }
+            idle();
+        }
+
+        void setup() {
+            row_port_out.setup();
+            col_port_in.setup();
+            idle();
+        }
+
+        void scan() {
+            for(u8 r = 0; r < rows; r++) {
+                row_port_out.write(all_rows & ~(port_data_t(1) << r));
+                delay_cycles<settle_cycles>();
+                cols_t down = ~cols_t(col_port_in.read()) & all_columns;
+
+                cols_t change = counter[r].tick(down ^ state[r]);
+                if(change) {
+                    state[r] ^= change;
+                    queue(r, change);
+                }
+            }
+            idle();
+        }
+
+        u8 available() {
+            // number of events waiting
+            u8 n = head + buffer_size - tail;
+            return (n >= buffer_size) ? n - buffer_size : n;
+        }
+
+        int read() {
+            // returns the next event, or -1 if there is none
+            if(head == tail) {
+                return -1;
+            }
+            u8 value = events[tail];
+            tail = next(tail);
+            return value;
+        }
+
+        boolean is_down(u8 row, u8 column) {
+            // the debounced state of a key
+            return (state[row] >> column) & 1;
+        }
+
+        boolean overflow() {
+            // true if events were dropped because the buffer was
+            // full, since the last call
+            boolean value;
+            atomic {
+                value = overruns;
+                overruns = false;
+            }
+            return value;
+        }
+
+    private:
+        static const port_data_t all_rows = port_data_t((2ULL << (rows - 1)) - 1);
+        static const cols_t all_columns = cols_t((2ULL << (columns - 1)) - 1);
+
+        static_assert(rows * columns <= 128, "KeyMatrix event codes hold up to 128 keys");
+
+        static u8 next(u8 i) {
+            return (i + 1 == buffer_size) ? 0 : i + 1;
+        }
+
+        inline void idle() {
+            // all rows high between scans
+            row_port_out.write(all_rows);
+        }
+
+        void queue(u8 r, cols_t change) {
+            cols_t bit = 1;
+            for(u8 c = 0; c < columns; c++, bit <<= 1) {
+                if(!(change & bit)) {
+                    continue;
+                }
+                u8 h = next(head);
+                if(h == tail) {
+                    overruns = true;
+                    return;
+                }
+                events[head] = (r * columns + c) | ((state[r] & bit) ? 0 : KEY_RELEASED);
+                head = h;
+            }
+        }
+
+        row_port row_port_out;
+        col_port col_port_in;
+        volatile cols_t state[rows];
+        VerticalCounter<cols_t, samples> counter[rows];
+
+        u8 events[buffer_size];
+        volatile u8 head;
+        volatile u8 tail;
+        volatile boolean overruns;
+};
@@ -0,0 +1,38 @@
+#include <DirectIO.h>
+#include "DirectIO_KeyMatrix.h"
+
+// Scan a 4x4 keypad every millisecond from a Timer1 interrupt:
+// rows on port C bits 0-3 (A0-A3 on an Uno),
+// columns on port D bits 4-7 (pins 4-7), with pullups.
+const char keys[] = "123A456B789C*0#D";
+KeyMatrix<OutputPort<PORT_C, 0, 4>, InputPort<PORT_D, 4, 4> > keypad;
+
+void setup() {
+  Serial.begin(115200);
+  for(u8 pin = 4; pin <= 7; pin++) {
+    pinMode(pin, INPUT_PULLUP);
+  }
+
+  // Timer1 in CTC mode, interrupting every millisecond
+  noInterrupts();
+  TCCR1A = 0;
+  TCCR1B = _BV(WGM12) | _BV(CS10);
+  OCR1A = F_CPU / 1000 - 1;
+  TIMSK1 = _BV(OCIE1A);
+  interrupts();
+}
+
+ISR(TIMER1_COMPA_vect) {
+  keypad.scan();
+}
+
+void loop() {
+  int event = keypad.read();
+  if(event >= 0) {
+    Serial.print(keys[event & ~KEY_RELEASED]);
+    Serial.println((event & KEY_RELEASED) ? " up" : " down");
+  }
+  if(keypad.overflow()) {
+    Serial.println("events lost");
+  }
+}
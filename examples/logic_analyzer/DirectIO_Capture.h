@@ -0,0 +1,571 @@
+/*
+  DirectIO_Capture.h - Logic analyzer capture using Direct IO library
+  Copyright (c) 2015-2018 Michael Marchetti.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <DirectIO.h>
+
+#if defined(DIRECTIO_FALLBACK)
+#error "Capture requires direct I/O support (AVR, SAM or SAMD boards)"
+#endif
+
+// Selects how Capture samples: a single unrolled burst after the
+// trigger, or a ring buffer that also keeps samples from before it.
+struct _capture_burst {};
+struct _capture_ring {};
+
+template <boolean burst> struct _capture_mode {
+    typedef _capture_burst type;
+};
+
+template <> struct _capture_mode<false> {
+    typedef _capture_ring type;
+};
+
+// Unrolls a burst of n samples by binary recursion,
+// so the generated code is straight-line loads and stores.
+template <class capture_t, u16 n>
+struct _capture_unroll {
+    static inline void run(u8*& p) {
+        _capture_unroll<capture_t, n / 2>::run(p);
+        _capture_unroll<capture_t, n - n / 2>::run(p);
+    }
+};
+
+template <class capture_t>
+struct _capture_unroll<capture_t, 1> {
+    static inline void run(u8*& p) {
+        *p++ = capture_t::sample();
+        delay_cycles<capture_t::pad>();
+    }
+};
+
+class CaptureTrigger {
+    // The trigger condition shared by the capture classes: a pattern
+    // on the inputs, optionally required to start matching (an edge).
+    // With no pattern set, capture starts immediately.
+    public:
+        CaptureTrigger() : mask(0), value(0), edge(false) {}
+
+        void trigger_immediate() {
+            mask = 0;
+            value = 0;
+            edge = false;
+        }
+
+        void trigger_pattern(u8 pattern_mask, u8 pattern_value) {
+            // trigger when (sample & pattern_mask) == pattern_value
+            mask = pattern_mask;
+            value = pattern_value & pattern_mask;
+            edge = false;
+        }
+
+        void trigger_edge(u8 lane, boolean rising=true) {
+            // trigger on a transition of one input
+            trigger_pattern(1 << lane, rising ? 0xFF : 0);
+            edge = true;
+        }
+
+        void trigger_pattern_edge(u8 pattern_mask, u8 pattern_value) {
+            // trigger when the pattern starts to match
+            // (it must fail to match first)
+            trigger_pattern(pattern_mask, pattern_value);
+            edge = true;
+        }
+
+    protected:
+        template <class capture_t>
+        inline void wait_trigger() {
+            if(edge) {
+                while((capture_t::sample() & mask) == value) {}
+            }
+            while((capture_t::sample() & mask) != value) {}
+        }
+
+        u8 mask;
+        u8 value;
+        boolean edge;
+};
+
+template <class input_port, u16 samples, u16 cycles, u16 pretrigger=0>
+class Capture : public CaptureTrigger {
+    // Samples up to 8 bits of an InputPort into RAM, one sample every
+    // cycles CPU cycles, like a logic analyzer.
+    //
+    // With pretrigger == 0, the port is polled until the trigger
+    // condition occurs, then all samples are taken in one fully unrolled
+    // sequence. This is the fastest mode: 3 cycles per sample on AVR
+    // (5.3 MS/s at 16 MHz), and about 4 on ARM.
+    //
+    // With pretrigger > 0, the port is sampled continuously into a ring
+    // buffer while the trigger is tested on every sample, so the
+    // pretrigger samples before the trigger are kept. This loop takes
+    // at least 11 cycles per sample on AVR, and about 12 on ARM.
+    //
+    // Larger values of cycles decimate the sample rate. Interrupts are
+    // disabled while sampling, and run() waits indefinitely for the
+    // trigger. On ARM the per-sample cycle counts are estimates, since
+    // port read latency varies between chips.
+    public:
+        Capture() : head(0) {}
+
+        void run() {
+            for(u16 i = 0; i < samples; i++) {
+                buffer[i] = 0;
+            }
+            atomic {
+                capture(mode_type());
+            }
+        }
+
+        u8 read(u16 i) {
+            // sample i, oldest first
+            u16 j = head + i;
+            return (buffer[(j >= samples) ? j - samples : j] & stored_mask) >> stored_shift;
+        }
+
+        u16 trigger_position() {
+            // index (for read) of the sample that met the trigger
+            return pretrigger;
+        }
+
+        static inline u8 sample() {
+            return u8((port::port_input_read() & input_port::mask) >> input_port::first_bit);
+        }
+
+    private:
+        typedef typename input_port::port_type port;
+        typedef typename _capture_mode<pretrigger == 0>::type mode_type;
+
+#if defined(ARDUINO_ARCH_AVR)
+        // The port is sampled as it is, to keep the loops short;
+        // read() masks off the other bits and shifts the inputs down.
+        static const u8 stored_mask = input_port::mask;
+        static const u8 stored_shift = input_port::first_bit;
+
+        static const u8 in_cycles = (port::in < 0x60) ? 1 : 2;
+        static const u16 burst_cycles = in_cycles + 2;
+        static const u16 ring_cycles = in_cycles + 10;
+#else
+        static const u8 stored_mask = 0xFF;
+        static const u8 stored_shift = 0;
+
+        // estimated cycles for each sample's load, shift and store
+        static const u16 burst_cycles = 4;
+        static const u16 ring_cycles = 12;
+#endif
+        static const u16 min_cycles = (pretrigger == 0) ? burst_cycles : ring_cycles;
+
+        static_assert(input_port::width <= 8, "Capture records up to 8 bits per sample");
+        static_assert(pretrigger + 1 < samples, "pretrigger must leave room for the trigger sample");
+        static_assert(cycles >= min_cycles, "sample rate is too high for this capture mode");
+
+    public:
+        // idle cycles added to each sample
+        static const u16 pad = cycles - min_cycles;
+
+    private:
+        void capture(_capture_burst) {
+            wait_trigger<Capture>();
+
+            u8* p = buffer;
+#if defined(ARDUINO_ARCH_AVR)
+            __asm__ __volatile__ (
+                ".rept %[n]                          \n"
+                "   .if %[addr] < 0x60               \n"
+                "       in __tmp_reg__, %[addr] - 0x20 \n"
+                "   .else                            \n"
+                "       lds __tmp_reg__, %[addr]     \n"
+                "   .endif                           \n"
+                "   st %a[p]+, __tmp_reg__           \n"
+                "   .rept %[pad]                     \n"
+                "       nop                          \n"
+                "   .endr                            \n"
+                ".endr                               \n"
+                : [p] "+e" (p)
+                : [addr] "n" (port::in), [n] "n" (samples), [pad] "n" (pad)
+            );
+#else
+            _capture_unroll<Capture, samples>::run(p);
+#endif
+            head = 0;
+        }
+
+#if defined(ARDUINO_ARCH_AVR)
+        void capture(_capture_ring) {
+            // Three loops of the same length: wait for the pattern to
+            // stop matching (edge triggers only), wait for it to match,
+            // then take the samples after the trigger. Each stores a
+            // sample and wraps the ring pointer; the wrap branch takes
+            // 2 cycles either way. The nop after each loop exit makes
+            // up for the branch not taken.
+            u8* p = buffer;
+            u8* start = buffer;
+            u8* end = buffer + samples;
+            u16 count = samples - pretrigger - 1;
+
+            // the trigger pattern, in port bit positions
+            u8 port_mask = mask << input_port::first_bit;
+            u8 port_value = value << input_port::first_bit;
+
+            __asm__ __volatile__ (
+                "   tst %[edge]                      \n"
+                "   breq 3f                          \n"
+                "1:                                  \n"
+                ".if %[addr] < 0x60                  \n"
+                "   in __tmp_reg__, %[addr] - 0x20   \n"
+                ".else                               \n"
+                "   lds __tmp_reg__, %[addr]         \n"
+                ".endif                              \n"
+                "   st %a[p]+, __tmp_reg__           \n"
+                ".rept %[pad]                        \n"
+                "   nop                              \n"
+                ".endr                               \n"
+                "   cp %A[p], %A[end]                \n"
+                "   cpc %B[p], %B[end]               \n"
+                "   brne 2f                          \n"
+                "   movw %A[p], %A[start]            \n"
+                "2: and __tmp_reg__, %[mask]         \n"
+                "   cp __tmp_reg__, %[value]         \n"
+                "   breq 1b                          \n"
+                "   nop                              \n"
+                "3:                                  \n"
+                ".if %[addr] < 0x60                  \n"
+                "   in __tmp_reg__, %[addr] - 0x20   \n"
+                ".else                               \n"
+                "   lds __tmp_reg__, %[addr]         \n"
+                ".endif                              \n"
+                "   st %a[p]+, __tmp_reg__           \n"
+                ".rept %[pad]                        \n"
+                "   nop                              \n"
+                ".endr                               \n"
+                "   cp %A[p], %A[end]                \n"
+                "   cpc %B[p], %B[end]               \n"
+                "   brne 4f                          \n"
+                "   movw %A[p], %A[start]            \n"
+                "4: and __tmp_reg__, %[mask]         \n"
+                "   cp __tmp_reg__, %[value]         \n"
+                "   brne 3b                          \n"
+                "   nop                              \n"
+                "5:                                  \n"
+                ".if %[addr] < 0x60                  \n"
+                "   in __tmp_reg__, %[addr] - 0x20   \n"
+                ".else                               \n"
+                "   lds __tmp_reg__, %[addr]         \n"
+                ".endif                              \n"
+                "   st %a[p]+, __tmp_reg__           \n"
+                ".rept %[pad]                        \n"
+                "   nop                              \n"
+                ".endr                               \n"
+                "   cp %A[p], %A[end]                \n"
+                "   cpc %B[p], %B[end]               \n"
+                "   brne 6f                          \n"
+                "   movw %A[p], %A[start]            \n"
+                "6: sbiw %[count], 1                 \n"
+                "   brne 5b                          \n"
+                : [p] "+e" (p), [count] "+w" (count)
+                : [start] "r" (start), [end] "r" (end), [mask] "r" (port_mask), [value] "r" (port_value),
+                  [edge] "r" (edge), [addr] "n" (port::in), [pad] "n" (pad)
+            );
+            head = p - buffer;
+        }
+#else
+#if defined(DIRECTIO_CYCLE_COUNTER)
+        static inline void pace(u32 start, u32& t) {
+            // wait for the next sample time
+            wait_cycles(start, t);
+            t += cycles;
+        }
+#else
+        static inline void pace(u32, u32&) {
+            delay_cycles<pad>();
+        }
+#endif
+
+        void capture(_capture_ring) {
+            u16 i = 0;
+            u16 count = samples - pretrigger - 1;
+            u8 s;
+            u32 start = 0;
+            u32 t = 0;
+
+#if defined(DIRECTIO_CYCLE_COUNTER)
+            cycle_counter_setup();
+            start = cycle_count();
+#endif
+            if(edge) {
+                do {
+                    pace(start, t);
+                    s = sample();
+                    buffer[i] = s;
+                    if(++i == samples) {
+                        i = 0;
+                    }
+                } while((s & mask) == value);
+            }
+            do {
+                pace(start, t);
+                s = sample();
+                buffer[i] = s;
+                if(++i == samples) {
+                    i = 0;
+                }
+            } while((s & mask) != value);
+            while(count--) {
+                pace(start, t);
+                buffer[i] = sample();
+                if(++i == samples) {
+                    i = 0;
+                }
+            }
+            head = i;
+        }
+#endif
+
+        u16 head;
+        u8 buffer[samples];
+};
+
+template <class input_port, u16 pairs, u16 cycles>
+class RleCapture : public CaptureTrigger {
+    // Samples up to 8 bits of an InputPort, one sample every cycles CPU
+    // cycles, and stores the result run-length encoded: each time the
+    // inputs change, the previous value is stored along with the number
+    // of samples it lasted. Each pair takes 3 bytes, so on signals that
+    // change slowly a capture covers far more samples than Capture could
+    // hold in the same RAM.
+    //
+    // Capture starts at the trigger and ends when all pairs are used, or
+    // when the given number of samples has been covered. A run longer
+    // than 65535 samples is split into several pairs.
+    //
+    // On AVR, the sampling loop takes 8 cycles plus the port read (at
+    // least 9 cycles per sample; 1.78 MS/s at 16 MHz). Storing a pair
+    // takes a few sample periods, during which the inputs aren't
+    // sampled, but the time is still counted, so durations stay exact;
+    // pulses shorter than that may be missed. On ARM the loop is paced
+    // by the cycle counter where there is one; on SAMD21 the timing is
+    // estimated, and durations drift when the inputs change often.
+    public:
+        // the sample rate, in samples per second
+        static const u32 sample_rate = F_CPU / cycles;
+        static const u16 period = cycles;
+        static const u8 channels = input_port::width;
+
+        RleCapture() : used(0), total(0), last(0) {}
+
+        void run(u32 max_samples=0xFFFFFFFF) {
+            // Capture until all pairs are used, or max_samples have been
+            // covered. Interrupts are disabled while sampling, and run()
+            // waits indefinitely for the trigger.
+            atomic {
+                wait_trigger<RleCapture>();
+                capture(max_samples);
+            }
+        }
+
+        u16 size() {
+            // number of pairs stored
+            return used;
+        }
+
+        u8 value(u16 i) {
+            // inputs during run i
+            return data[3 * i] >> stored_shift;
+        }
+
+        u16 duration(u16 i) {
+            // length of run i, in samples
+            return data[3 * i + 1] | (u16(data[3 * i + 2]) << 8);
+        }
+
+        u32 length() {
+            // total samples covered by the stored pairs
+            return total;
+        }
+
+        u8 last_value() {
+            // inputs when capture ended (the run that was not stored)
+            return last >> stored_shift;
+        }
+
+        static inline u8 sample() {
+            return u8((port::port_input_read() & input_port::mask) >> input_port::first_bit);
+        }
+
+    private:
+        typedef typename input_port::port_type port;
+
+        static_assert(input_port::width <= 8, "RleCapture records up to 8 bits per sample");
+
+#if defined(ARDUINO_ARCH_AVR)
+        // the port is sampled without shifting; value() shifts it down
+        static const u8 stored_shift = input_port::first_bit;
+
+        static const u8 in_cycles = (port::in < 0x60) ? 1 : 2;
+        static const u16 min_cycles = in_cycles + 8;
+        static_assert(cycles >= min_cycles, "sample rate is too high for RleCapture");
+
+        static const u8 pad = cycles - min_cycles;
+
+        // Storing a pair takes store_cycles from the sample that ended
+        // the run to the next one; this is padded to a whole number of
+        // sample periods, which are counted in the new run.
+        static const u16 store_cycles = in_cycles + 34;
+        static const u16 store_periods = (store_cycles + cycles - 1) / cycles;
+        static const u16 store_pad = store_periods * cycles - store_cycles;
+
+        void capture(u32 limit) {
+            u8* p = data;
+            u8* end = data + 3 * pairs;
+            u32 sum = 0;
+            u16 count;
+            u8 s;
+            u8 v;
+
+            // Three paths, each timed from one port read to the next:
+            // the same value (count it), a count overflow, and a change.
+            // The last two store a pair and start a new run.
+            __asm__ __volatile__ (
+                ".if %[addr] < 0x60                  \n"
+                "   in %[s], %[addr] - 0x20          \n"
+                ".else                               \n"
+                "   lds %[s], %[addr]                \n"
+                ".endif                              \n"
+                "   andi %[s], %[mask]               \n"
+                "   mov %[v], %[s]                   \n"
+                "   ldi %A[count], 1                 \n"
+                "   clr %B[count]                    \n"
+                ".rept %[pad] + 4                    \n"
+                "   nop                              \n"
+                ".endr                               \n"
+                "1:                                  \n"
+                ".if %[addr] < 0x60                  \n"
+                "   in %[s], %[addr] - 0x20          \n"
+                ".else                               \n"
+                "   lds %[s], %[addr]                \n"
+                ".endif                              \n"
+                "   andi %[s], %[mask]               \n"
+                "   cp %[s], %[v]                    \n"
+                "   brne 2f                          \n"
+                "   adiw %[count], 1                 \n"
+                "   breq 3f                          \n"
+                ".rept %[pad]                        \n"
+                "   nop                              \n"
+                ".endr                               \n"
+                "   rjmp 1b                          \n"
+                "3: sbiw %[count], 1                 \n"
+                "   rjmp 4f                          \n"
+                "2: rjmp .+0                         \n"
+                "   rjmp .+0                         \n"
+                "   rjmp .+0                         \n"
+                "   nop                              \n"
+                "4: st %a[p]+, %[v]                  \n"
+                "   st %a[p]+, %A[count]             \n"
+                "   st %a[p]+, %B[count]             \n"
+                "   mov %[v], %[s]                   \n"
+                "   add %A[sum], %A[count]           \n"
+                "   adc %B[sum], %B[count]           \n"
+                "   adc %C[sum], __zero_reg__        \n"
+                "   adc %D[sum], __zero_reg__        \n"
+                "   cp %A[p], %A[end]                \n"
+                "   cpc %B[p], %B[end]               \n"
+                "   breq 5f                          \n"
+                "   cp %A[sum], %A[limit]            \n"
+                "   cpc %B[sum], %B[limit]           \n"
+                "   cpc %C[sum], %C[limit]           \n"
+                "   cpc %D[sum], %D[limit]           \n"
+                "   brsh 5f                          \n"
+                "   ldi %A[count], lo8(%[periods])   \n"
+                "   ldi %B[count], hi8(%[periods])   \n"
+                ".rept %[store_pad]                  \n"
+                "   nop                              \n"
+                ".endr                               \n"
+                "   rjmp 1b                          \n"
+                "5:                                  \n"
+                : [p] "+e" (p), [sum] "+r" (sum), [count] "=&w" (count), [s] "=&d" (s), [v] "=&r" (v)
+                : [end] "r" (end), [limit] "r" (limit), [addr] "n" (port::in), [mask] "M" (input_port::mask),
+                  [pad] "n" (pad), [periods] "n" (store_periods), [store_pad] "n" (store_pad)
+            );
+            used = (p - data) / 3;
+            total = sum;
+            last = v;
+        }
+#else
+        static const u8 stored_shift = 0;
+
+        // estimated cycles for each sample's load, compare and count
+        static const u16 min_cycles = 8;
+        static_assert(cycles >= min_cycles, "sample rate is too high for RleCapture");
+
+#if defined(DIRECTIO_CYCLE_COUNTER)
+        static inline void pace(u32 start, u32& t) {
+            // wait for the next sample time
+            wait_cycles(start, t);
+            t += cycles;
+        }
+#else
+        static inline void pace(u32, u32&) {
+            delay_cycles<cycles - min_cycles>();
+        }
+#endif
+
+        void capture(u32 limit) {
+            u8* p = data;
+            u8* end = data + 3 * pairs;
+            u32 sum = 0;
+            u16 count = 1;
+            u32 start = 0;
+            u32 t = 0;
+
+#if defined(DIRECTIO_CYCLE_COUNTER)
+            cycle_counter_setup();
+            start = cycle_count();
+#endif
+            pace(start, t);
+            u8 v = sample();
+            for(;;) {
+                pace(start, t);
+                u8 s = sample();
+                if(s == v && ++count != 0) {
+                    continue;
+                }
+                if(count == 0) {
+                    // overflow: store a full run and start another
+                    count = 0xFFFF;
+                }
+                *p++ = v;
+                *p++ = u8(count);
+                *p++ = u8(count >> 8);
+                sum += count;
+                v = s;
+                count = 1;
+                if(p == end || sum >= limit) {
+                    break;
+                }
+            }
+            used = (p - data) / 3;
+            total = sum;
+            last = v;
+        }
+#endif
+
+        u16 used;
+        u32 total;
+        u8 last;
+        u8 data[3 * pairs];
+};
@@ -0,0 +1,193 @@
+/*
+  DirectIO_Sump.h - SUMP logic analyzer protocol using Direct IO library
+  Copyright (c) 2015-2018 Michael Marchetti.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "DirectIO_Capture.h"
+
+// SUMP commands
+const u8 SUMP_RESET = 0x00;
+const u8 SUMP_RUN = 0x01;
+const u8 SUMP_ID = 0x02;
+const u8 SUMP_METADATA = 0x04;
+const u8 SUMP_XON = 0x11;
+const u8 SUMP_XOFF = 0x13;
+const u8 SUMP_DIVIDER = 0x80;
+const u8 SUMP_CAPTURE_SIZE = 0x81;
+const u8 SUMP_FLAGS = 0x82;
+const u8 SUMP_TRIGGER_MASK = 0xC0;
+const u8 SUMP_TRIGGER_VALUES = 0xC1;
+const u8 SUMP_TRIGGER_CONFIG = 0xC2;
+
+// flags: channel groups 0-3 are disabled by bits 2-5
+const u32 SUMP_FLAG_GROUP0_DISABLED = 0x04;
+
+// the reference clock that the SUMP sample rate divider counts
+const u32 SUMP_CLOCK = 100000000UL;
+
+template <class capture_t>
+class SumpResponder {
+    // Implements the SUMP protocol used by the Open Logic Sniffer, so
+    // that sigrok (PulseView) and other clients can drive an RleCapture
+    // over a serial port. In PulseView, pick the "Openbench Logic
+    // Sniffer & SUMP compatibles" driver.
+    //
+    // The capture always samples at its compile-time rate, and the run
+    // length encoded result is resampled to the rate the host asks for
+    // as it is sent, so any rate up to sample_rate may be chosen.
+    // Stage 0 of the host's trigger sets a pattern trigger. Samples
+    // before the trigger are not recorded, so the host's capture ratio
+    // should be 0%. Call poll() from loop().
+    public:
+        SumpResponder(capture_t& capture, Stream& stream) :
+            capture(capture), stream(stream),
+            divider(0), read_count(4096), flags(0), trigger_mask(0), trigger_values(0) {}
+
+        void poll() {
+            if(!stream.available()) {
+                return;
+            }
+            u8 command = stream.read();
+            u32 arg = 0;
+            if(command & 0x80) {
+                // long commands carry 4 bytes, least significant first
+                u8 b[4];
+                if(stream.readBytes(b, 4) != 4) {
+                    return;
+                }
+                arg = b[0] | (u32(b[1]) << 8) | (u32(b[2]) << 16) | (u32(b[3]) << 24);
+            }
+
+            switch(command) {
+                case SUMP_ID:
+                    stream.print("1ALS");
+                    break;
+                case SUMP_METADATA:
+                    metadata();
+                    break;
+                case SUMP_RUN:
+                    run();
+                    break;
+                case SUMP_DIVIDER:
+                    divider = arg & 0xFFFFFF;
+                    break;
+                case SUMP_CAPTURE_SIZE:
+                    // in units of 4 samples, less one; the delay count
+                    // in the upper half is not used
+                    read_count = ((arg & 0xFFFF) + 1) * 4;
+                    break;
+                case SUMP_FLAGS:
+                    flags = arg;
+                    break;
+                case SUMP_TRIGGER_MASK:
+                    trigger_mask = arg;
+                    break;
+                case SUMP_TRIGGER_VALUES:
+                    trigger_values = arg;
+                    break;
+                default:
+                    // reset, flow control and the other trigger stages
+                    break;
+            }
+        }
+
+    private:
+        void metadata() {
+            stream.write(u8(0x01));
+            stream.print("DirectIO");
+            stream.write(u8(0));
+            write_key(0x20, capture_t::channels);
+            write_key(0x21, max_samples);
+            write_key(0x23, capture_t::sample_rate);
+            write_key(0x24, 2);
+            stream.write(u8(0));
+        }
+
+        void write_key(u8 key, u32 value) {
+            // 32 bit values are sent most significant first
+            stream.write(key);
+            stream.write(u8(value >> 24));
+            stream.write(u8(value >> 16));
+            stream.write(u8(value >> 8));
+            stream.write(u8(value));
+        }
+
+        void run() {
+            // Sample n of the host's rate is sample n * host / base of
+            // the capture; both periods are in units of 1 / (100 * F_CPU)
+            // seconds, so they are whole numbers.
+            u32 host = (divider + 1) * (F_CPU / 1000000UL);
+            u32 base = 100UL * capture_t::period;
+
+            u32 last_host = read_count - 1;
+            u32 q = u32((unsigned long long)(last_host) * host / base);
+            u32 r = u32((unsigned long long)(last_host) * host % base);
+
+            u8 mask = u8(trigger_mask);
+            if(mask) {
+                capture.trigger_pattern(mask, u8(trigger_values));
+            }
+            else {
+                capture.trigger_immediate();
+            }
+            capture.run(q + 1);
+
+            // the host expects the newest sample first
+            u32 dq = host / base;
+            u32 dr = host % base;
+            u16 i = capture.size();
+            u32 run_start = capture.length();
+            for(u32 n = read_count; n--; ) {
+                // find the run holding capture sample q
+                while(i > 0 && q < run_start) {
+                    i--;
+                    run_start -= capture.duration(i);
+                }
+                write_sample((i == capture.size()) ? capture.last_value() : capture.value(i));
+
+                if(n) {
+                    if(r < dr) {
+                        r += base;
+                        q--;
+                    }
+                    r -= dr;
+                    q -= dq;
+                }
+            }
+        }
+
+        void write_sample(u8 value) {
+            // one byte for each enabled group of 8 channels
+            for(u8 group = 0; group < 4; group++) {
+                if(!(flags & (SUMP_FLAG_GROUP0_DISABLED << group))) {
+                    stream.write(group == 0 ? value : u8(0));
+                }
+            }
+        }
+
+        // the largest capture size the host can request
+        static const u32 max_samples = 0x10000UL * 4;
+
+        capture_t& capture;
+        Stream& stream;
+
+        u32 divider;
+        u32 read_count;
+        u32 flags;
+        u32 trigger_mask;
+        u32 trigger_values;
+};
@@ -0,0 +1,22 @@
+#include <DirectIO.h>
+#include "DirectIO_Sump.h"
+
+// A logic analyzer for PulseView/sigrok, on port B bits 0-5
+// (pins 8-13 on an Uno). Select the "Openbench Logic Sniffer & SUMP
+// compatibles" driver at 115200 baud, and a capture ratio of 0%.
+//
+// Samples at 1 MS/s (16 cycles per sample at 16 MHz) and stores
+// them run length encoded, in up to 400 pairs (1200 bytes).
+// For short bursts at higher rates, or to keep samples from before
+// the trigger, see Capture in DirectIO_Capture.h.
+typedef InputPort<PORT_B, 0, 6> Probes;
+RleCapture<Probes, 400, 16> capture;
+SumpResponder<RleCapture<Probes, 400, 16> > sump(capture, Serial);
+
+void setup() {
+  Serial.begin(115200);
+}
+
+void loop() {
+  sump.poll();
+}
@@ -0,0 +1,383 @@
+/*
+  DirectIO_Manchester.h - Manchester encoded frame transmitter and receiver using Direct IO library
+  Copyright (c) 2015-2018 Michael Marchetti.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <DirectIO.h>
+
+#if defined(DIRECTIO_FALLBACK)
+#error "ManchesterTx and ManchesterRx require direct I/O support (AVR, SAM or SAMD boards)"
+#endif
+
+// Frames are sent as a preamble of 0x55 bytes, the sync word 0x2DD4,
+// a length byte (1 to max_length), the data and a CRC-16 (CCITT,
+// initial value 0xFFFF, sent high byte first) of the length and data.
+// Bits are sent MSB first, with IEEE 802.3 encoding: a 0 is a falling
+// edge in the middle of the bit time, a 1 a rising edge.
+const u16 MANCHESTER_SYNC = 0x2DD4;
+
+static inline u16 _manchester_crc(u16 crc, u8 value) {
+    crc ^= u16(value) << 8;
+    for(u8 i = 0; i < 8; i++) {
+        crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+    }
+    return crc;
+}
+
+template <u8 pin, u32 bitrate, u8 preamble=4>
+class ManchesterTx {
+    // Sends Manchester encoded frames. Every half-bit edge is placed at
+    // a cycle count computed at compile time from F_CPU and the bit
+    // rate. Interrupts are disabled while a frame is sent.
+    //
+    // On AVR, the bits of each byte are unrolled and each half bit is a
+    // single port store. On SAM and SAMD51 boards, edges are timed
+    // against the DWT cycle counter. SAMD21 boards have no cycle
+    // counter, so their bit times are open loop. Either way, the
+    // receiver's clock recovery absorbs the small rounding error in
+    // the bit time.
+    public:
+        ManchesterTx() : out(LOW) {}
+
+        void send(const u8* data, u8 length) {
+            u16 crc = _manchester_crc(0xFFFF, length);
+            for(u8 i = 0; i < length; i++) {
+                crc = _manchester_crc(crc, data[i]);
+            }
+
+            atomic {
+                begin();
+                for(u8 i = 0; i < preamble; i++) {
+                    send_byte(0x55);
+                }
+                send_byte(MANCHESTER_SYNC >> 8);
+                send_byte(MANCHESTER_SYNC & 0xFF);
+                send_byte(length);
+                for(u8 i = 0; i < length; i++) {
+                    send_byte(data[i]);
+                }
+                send_byte(crc >> 8);
+                send_byte(crc & 0xFF);
+                out = LOW;
+            }
+        }
+
+    private:
+#if defined(DIRECTIO_CYCLE_COUNTER)
+        // half bit time in 1/256 cycle units
+        static const u32 half_time = u32(((unsigned long long)(F_CPU) * 128 + bitrate / 2) / bitrate);
+
+        void begin() {
+            cycle_counter_setup();
+            start = cycle_count();
+            t = 0;
+        }
+
+        void send_byte(u8 value) {
+            for(u8 i = 0; i < 8; i++) {
+                boolean b = (value & 0x80) != 0;
+                value <<= 1;
+                wait_cycles(start, t >> 8);
+                out = !b;
+                t += half_time;
+                wait_cycles(start, t >> 8);
+                out = b;
+                t += half_time;
+            }
+
+            // move the whole cycles into start, so t holds less than a
+            // byte's time and doesn't overflow on long frames
+            start += t >> 8;
+            t &= 0xFF;
+        }
+
+        u32 start;
+        u32 t;
+#else
+        // AVR and Cortex-M0+: each byte is unrolled, with compile-time
+        // delays between the port stores. store_cycles is the length of
+        // the store instruction, data_cycles the time needed to prepare
+        // a data bit, and byte_cycles an estimate of the time between
+        // bytes spent fetching the next one.
+#if defined(ARDUINO_ARCH_AVR)
+        static const u8 store_cycles = (_pins<pin>::out < 0x60) ? 1 : 2;
+        static const u8 data_cycles = 3;
+        static const u8 byte_cycles = 8;
+
+        template <u8 k>
+        static inline void data_bit(u8 value, u8 lo) {
+            // copy lo and bit k of value into the port bit, then store;
+            // the copy is in the asm so that data_cycles is exact
+            u8 v;
+            __asm__ __volatile__ (
+                "mov %[v], %[lo]             \n"
+                "bst %[value], %[k]          \n"
+                "bld %[v], %[bit]            \n"
+                ".if %[addr] < 0x60         \n"
+                "   out %[addr] - 0x20, %[v] \n"
+                ".else                      \n"
+                "   sts %[addr], %[v]        \n"
+                ".endif                     \n"
+                : [v] "=&r" (v)
+                : [lo] "r" (lo), [value] "r" (value), [k] "n" (k),
+                  [bit] "n" (_pins<pin>::bit), [addr] "n" (_pins<pin>::out)
+            );
+        }
+
+        void begin() {
+            lo = *port_t(_pins<pin>::out) & ~(1 << _pins<pin>::bit);
+        }
+#else
+        static const u8 store_cycles = 2;
+        static const u8 data_cycles = 4;
+        static const u8 byte_cycles = 10;
+
+        template <u8 k>
+        static inline void data_bit(u8 value, port_data_t v) {
+            _pins<pin>::port_output_write(v | (port_data_t((value >> k) & 1) << _pins<pin>::bit));
+        }
+
+        void begin() {
+            lo = _pins<pin>::port_output_read() & ~_pins<pin>::mask;
+        }
+#endif
+
+        static const u32 half_cycles = (F_CPU + bitrate) / (2 * bitrate);
+        static const u32 gap = half_cycles - store_cycles - data_cycles;
+
+        static_assert(half_cycles >= store_cycles + data_cycles + byte_cycles, "bitrate is too high for this CPU clock");
+
+        template <u8 k>
+        inline void send_bit(u8 value, u8 inverse) {
+            // the first half of the bit is its inverse
+            data_bit<k>(inverse, lo);
+            delay_cycles<gap>();
+            data_bit<k>(value, lo);
+            delay_cycles<k ? gap : gap - byte_cycles>();
+        }
+
+        inline void send_byte(u8 value) {
+            u8 inverse = ~value;
+            send_bit<7>(value, inverse);
+            send_bit<6>(value, inverse);
+            send_bit<5>(value, inverse);
+            send_bit<4>(value, inverse);
+            send_bit<3>(value, inverse);
+            send_bit<2>(value, inverse);
+            send_bit<1>(value, inverse);
+            send_bit<0>(value, inverse);
+        }
+
+        port_data_t lo;
+#endif
+
+        Output<pin> out;
+};
+
+template <u8 pin, u32 bitrate, u32 timer_rate=F_CPU / 8, u8 max_length=32>
+class ManchesterRx {
+    // Receives frames sent by ManchesterTx. Call edge() on every edge of
+    // the input with a 16 bit timestamp from a timer running at
+    // timer_rate, ideally from a timer input capture interrupt, which
+    // timestamps the edge in hardware.
+    //
+    // Each interval between edges is one half bit (short) or a whole bit
+    // (long). A long interval always ends in the middle of a bit, which
+    // locks the decoder on the preamble; after that, the decoder knows
+    // which edges fall mid-bit and carry data. The half bit time is
+    // tracked from the measured intervals, so the receiver follows a
+    // transmitter whose clock is off by a few percent. Anything else
+    // (a glitch or a gap) drops back to looking for a preamble.
+    //
+    // Frames are received into one of two buffers while the other holds
+    // the last good frame until it is read. A frame that arrives before
+    // the previous one is read is dropped.
+    public:
+        ManchesterRx() : in(false), last(0), state(HUNT), current(0), done(0), ready(false), crc_errors(0) {
+            unlock();
+        }
+
+        void edge(u16 now) {
+            edge(now, in);
+        }
+
+        void edge(u16 now, boolean level) {
+            // level is the input after the edge
+            u16 interval = now - last;
+            last = now;
+            if(interval > max_ticks) {
+                unlock();
+                return;
+            }
+
+            // the interval and half bit time have 4 fractional bits
+            u16 t = interval << 4;
+            boolean whole;
+            if(t < half - half / 2) {
+                unlock();
+                return;
+            }
+            else if(t < half + half / 2) {
+                whole = false;
+            }
+            else if(t < 2 * half + half / 2) {
+                whole = true;
+            }
+            else {
+                unlock();
+                return;
+            }
+
+            if(!locked) {
+                if(whole) {
+                    locked = true;
+                    mid = true;
+                    receive_bit(level);
+                }
+                return;
+            }
+
+            // clock recovery: move the half bit time 1/8 of the way
+            // towards this interval
+            u16 measured = whole ? t >> 1 : t;
+            half += (i16(measured - half)) >> 3;
+
+            if(mid) {
+                if(whole) {
+                    receive_bit(level);
+                }
+                else {
+                    mid = false;
+                }
+            }
+            else if(whole) {
+                unlock();
+            }
+            else {
+                mid = true;
+                receive_bit(level);
+            }
+        }
+
+        u8 available() {
+            // the length of the frame waiting to be read, or 0
+            return ready ? length[done] : 0;
+        }
+
+        u8 read(u8* data) {
+            // copies the waiting frame into data, and returns its
+            // length (0 if there is no frame)
+            if(!ready) {
+                return 0;
+            }
+            u8 n = length[done];
+            for(u8 i = 0; i < n; i++) {
+                data[i] = buffer[done][i];
+            }
+            ready = false;
+            return n;
+        }
+
+        u16 errors() {
+            // frames discarded for a bad CRC since the last call
+            u16 value;
+            atomic {
+                value = crc_errors;
+                crc_errors = 0;
+            }
+            return value;
+        }
+
+    private:
+        enum { HUNT, LENGTH, DATA };
+
+        // nominal half bit time, in timer ticks
+        static const u16 half_ticks = u16((timer_rate + bitrate) / (2 * bitrate));
+        static const u16 max_ticks = 3 * half_ticks;
+
+        static_assert(half_ticks >= 4, "timer_rate is too low for this bitrate");
+        static_assert(half_ticks < 1024, "timer_rate is too high for this bitrate");
+        static_assert(max_length >= 1 && max_length <= 253, "max_length must be from 1 to 253 (count is a u8)");
+
+        void unlock() {
+            locked = false;
+            state = HUNT;
+            shift = 0;
+            half = half_ticks << 4;
+        }
+
+        void receive_bit(boolean value) {
+            shift = (shift << 1) | value;
+            if(state == HUNT) {
+                if(shift == MANCHESTER_SYNC) {
+                    state = LENGTH;
+                    bits = 0;
+                }
+                return;
+            }
+            if(++bits < 8) {
+                return;
+            }
+            bits = 0;
+
+            u8 data = shift & 0xFF;
+            if(state == LENGTH) {
+                if(data == 0 || data > max_length) {
+                    unlock();
+                    return;
+                }
+                length[current] = data;
+                count = 0;
+                crc = _manchester_crc(0xFFFF, data);
+                state = DATA;
+                return;
+            }
+
+            // the data, then the CRC; the CRC of both together is 0
+            crc = _manchester_crc(crc, data);
+            buffer[current][count] = data;
+            if(++count == length[current] + 2) {
+                if(crc != 0) {
+                    crc_errors++;
+                }
+                else if(!ready) {
+                    done = current;
+                    current ^= 1;
+                    ready = true;
+                }
+                unlock();
+            }
+        }
+
+        Input<pin> in;
+        u16 last;
+        u16 half;
+        boolean locked;
+        boolean mid;
+        u8 state;
+        u16 shift;
+        u8 bits;
+        u8 count;
+        u16 crc;
+
+        u8 buffer[2][max_length + 2];
+        u8 length[2];
+        u8 current;
+        volatile u8 done;
+        volatile boolean ready;
+        volatile u16 crc_errors;
+};
@@ -0,0 +1,68 @@
+#include <DirectIO.h>
+#include "DirectIO_Manchester.h"
+
+// A Manchester link at 20 kbps, e.g. over a pair of 433 MHz OOK
+// modules. Load this sketch on two Unos, one with TRANSMITTER defined:
+// the transmitter drives pin 4, and the receiver listens on pin 8
+// (ICP1), so Timer 1 timestamps each edge in hardware.
+#define TRANSMITTER
+
+const u32 bitrate = 20000;
+
+#if defined(TRANSMITTER)
+
+ManchesterTx<4, bitrate> tx;
+u8 counter = 0;
+
+void setup() {
+}
+
+void loop() {
+  u8 message[] = { 'D', 'I', 'O', counter++ };
+  tx.send(message, sizeof(message));
+  delay(100);
+}
+
+#else
+
+// Timer 1 runs at F_CPU / 8 (2 MHz on an Uno)
+ManchesterRx<8, bitrate, F_CPU / 8> rx;
+
+ISR(TIMER1_CAPT_vect) {
+  // capture the other edge next
+  u8 control = TCCR1B;
+  TCCR1B = control ^ _BV(ICES1);
+  TIFR1 = _BV(ICF1);
+  rx.edge(ICR1, (control & _BV(ICES1)) != 0);
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  noInterrupts();
+  TCCR1A = 0;
+  TCCR1B = _BV(ICES1) | _BV(CS11);
+  TIFR1 = _BV(ICF1);
+  TIMSK1 = _BV(ICIE1);
+  interrupts();
+}
+
+void loop() {
+  u8 frame[32];
+  u8 n = rx.read(frame);
+  if(n) {
+    for(u8 i = 0; i < n; i++) {
+      Serial.print(frame[i], HEX);
+      Serial.print(' ');
+    }
+    Serial.println();
+  }
+
+  u16 errors = rx.errors();
+  if(errors) {
+    Serial.print("CRC errors: ");
+    Serial.println(errors);
+  }
+}
+
+#endif
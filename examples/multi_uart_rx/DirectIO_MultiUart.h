@@ -0,0 +1,198 @@
+/*
+  DirectIO_MultiUart.h - Multi-channel software UART receiver using Direct IO library
+  Copyright (c) 2015-2018 Michael Marchetti.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <DirectIO.h>
+
+template <class input_port, u32 baud, u8 oversample=4, u8 buffer_size=16>
+class MultiUartRx {
+    // Receives serial data (8 data bits, no parity, 1 stop bit) on every
+    // bit of an InputPort at once: up to 8 lines on AVR, 32 on SAM/SAMD.
+    //
+    // Call tick() from a timer interrupt running at tick_rate
+    // (baud * oversample). Each tick reads the port once. The lines are
+    // processed in parallel, one bit per line in each word ("bit-sliced"):
+    // - A falling edge on an idle line is a start bit. The line is assigned
+    //   to the tick phase half a bit later, so it is sampled mid-bit.
+    // - Each line's shift register is stored vertically in planes,
+    //   one word per bit position. A marker bit is shifted along with the
+    //   data and reaches plane 0 when the stop bit has been sampled.
+    // Only completed bytes are handled per line, by copying them
+    // into that line's receive buffer.
+    public:
+        static const u32 tick_rate = baud * oversample;
+        static const u8 lanes = input_port::width;
+        typedef bits_type(lanes) lanes_t;
+
+        MultiUartRx() : phase(0), last(lanes_t(-1)), idle(lanes_t(-1)), waiting(0), errors(0), overruns(0) {
+            for(u8 i = 0; i < oversample; i++) {
+                sampling[i] = 0;
+            }
+            for(u8 i = 0; i < 10; i++) {
+                planes[i] = 0;
+            }
+            for(u8 i = 0; i < lanes; i++) {
+                head[i] = 0;
+                tail[i] = 0;
+            }
+        }
+
+        void setup() {
+            port.setup();
+        }
+
+        void tick() {
+            lanes_t now = port.read();
+            lanes_t sample = sampling[phase];
+
+            if(sample) {
+                // lanes in the middle of a start bit: it must still be low,
+                // otherwise it was a glitch and the lane goes back to idle.
+                lanes_t starting = sample & waiting;
+                lanes_t glitch = starting & now;
+                waiting &= ~starting;
+                idle |= glitch;
+                sampling[phase] &= ~glitch;
+
+                // all other lanes shift in a data or stop bit
+                lanes_t shifting = sample & ~starting;
+                if(shifting) {
+                    for(u8 i = 0; i < 9; i++) {
+                        planes[i] = (planes[i] & ~shifting) | (planes[i + 1] & shifting);
+                    }
+                    planes[9] = (planes[9] & ~shifting) | (now & shifting);
+
+                    lanes_t done = planes[0] & shifting;
+                    if(done) {
+                        complete(done);
+                    }
+                }
+
+                // confirmed start bits get a marker in the top plane
+                planes[9] |= starting & ~now;
+            }
+
+            // new start bits: sample them half a bit time from now
+            lanes_t started = idle & last & ~now;
+            if(started) {
+                u8 slot = phase + oversample / 2;
+                if(slot >= oversample) {
+                    slot -= oversample;
+                }
+                sampling[slot] |= started;
+                waiting |= started;
+                idle &= ~started;
+            }
+
+            last = now;
+            if(++phase == oversample) {
+                phase = 0;
+            }
+        }
+
+        u8 available(u8 lane) {
+            // number of bytes waiting in the lane's receive buffer
+            u16 n = u16(head[lane]) + buffer_size - tail[lane];
+            return (n >= buffer_size) ? n - buffer_size : n;
+        }
+
+        int read(u8 lane) {
+            // returns the next byte received on the lane, or -1 if there is none
+            if(head[lane] == tail[lane]) {
+                return -1;
+            }
+            u8 value = buffer[lane][tail[lane]];
+            tail[lane] = next(tail[lane]);
+            return value;
+        }
+
+        lanes_t framing_errors() {
+            // lanes that received a byte without a valid stop bit
+            // since the last call (those bytes are discarded).
+            lanes_t value;
+            atomic {
+                value = errors;
+                errors = 0;
+            }
+            return value;
+        }
+
+        lanes_t overflows() {
+            // lanes that dropped a byte because their buffer was full
+            // since the last call.
+            lanes_t value;
+            atomic {
+                value = overruns;
+                overruns = 0;
+            }
+            return value;
+        }
+
+    private:
+        static u8 next(u8 i) {
+            return (i + 1 == buffer_size) ? 0 : i + 1;
+        }
+
+        void complete(lanes_t done) {
+            // Unpack the bytes for lanes that have sampled their stop bit:
+            // the data bits are in planes 1-8 (LSB first), the stop bit in plane 9.
+            lanes_t bit = 1;
+            for(u8 lane = 0; lane < lanes; lane++, bit <<= 1) {
+                if(!(done & bit)) {
+                    continue;
+                }
+                if(planes[9] & bit) {
+                    u8 value = 0;
+                    for(u8 i = 8; i > 0; i--) {
+                        value = (value << 1) | ((planes[i] & bit) ? 1 : 0);
+                    }
+                    u8 h = next(head[lane]);
+                    if(h != tail[lane]) {
+                        buffer[lane][head[lane]] = value;
+                        head[lane] = h;
+                    }
+                    else {
+                        overruns |= bit;
+                    }
+                }
+                else {
+                    errors |= bit;
+                }
+            }
+
+            for(u8 i = 0; i < 10; i++) {
+                planes[i] &= ~done;
+            }
+            sampling[phase] &= ~done;
+            idle |= done;
+        }
+
+        input_port port;
+        u8 phase;
+        lanes_t last;
+        lanes_t idle;
+        lanes_t waiting;
+        lanes_t sampling[oversample];
+        lanes_t planes[10];
+        volatile lanes_t errors;
+        volatile lanes_t overruns;
+
+        u8 buffer[lanes][buffer_size];
+        volatile u8 head[lanes];
+        volatile u8 tail[lanes];
+};
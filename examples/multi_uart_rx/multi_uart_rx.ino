@@ -0,0 +1,42 @@
+#include <DirectIO.h>
+#include "DirectIO_MultiUart.h"
+
+// Receive six 9600 baud serial lines on port D bits 2-7
+// (pins 2-7 on an Uno), sampling 4 times per bit from a Timer1 interrupt.
+// Pins 0 and 1 are left free for the hardware serial port.
+typedef MultiUartRx<InputPort<PORT_D, 2, 6>, 9600, 4> Receiver;
+Receiver rx;
+
+void setup() {
+  Serial.begin(115200);
+  rx.setup();
+
+  // Timer1 in CTC mode, interrupting at Receiver::tick_rate
+  noInterrupts();
+  TCCR1A = 0;
+  TCCR1B = _BV(WGM12) | _BV(CS10);
+  OCR1A = F_CPU / Receiver::tick_rate - 1;
+  TIMSK1 = _BV(OCIE1A);
+  interrupts();
+}
+
+ISR(TIMER1_COMPA_vect) {
+  rx.tick();
+}
+
+void loop() {
+  for(u8 lane = 0; lane < Receiver::lanes; lane++) {
+    int c = rx.read(lane);
+    if(c >= 0) {
+      Serial.print(lane);
+      Serial.print(": ");
+      Serial.println(c, HEX);
+    }
+  }
+
+  u8 errors = rx.framing_errors();
+  if(errors) {
+    Serial.print("framing errors: ");
+    Serial.println(errors, BIN);
+  }
+}
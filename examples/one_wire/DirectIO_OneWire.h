@@ -0,0 +1,511 @@
+/*
+  DirectIO_OneWire.h - Bit-banged 1-Wire master using Direct IO library
+  Copyright (c) 2015-2018 Michael Marchetti.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <DirectIO.h>
+
+#if defined(DIRECTIO_FALLBACK)
+#error "OneWire requires direct I/O support (AVR, SAM or SAMD boards)"
+#endif
+
+// Slot timing for each 1-Wire speed, in nanoseconds.
+// Values are the recommended delays from Maxim application note 126.
+struct ONEWIRE_STANDARD {
+    static const u32 a = 6000;      // write 1 / read low time
+    static const u32 b = 64000;     // write 1 recovery
+    static const u32 c = 60000;     // write 0 low time
+    static const u32 d = 10000;     // write 0 recovery
+    static const u32 e = 9000;      // read sample delay
+    static const u32 f = 55000;     // read recovery
+    static const u32 g = 0;         // delay before reset
+    static const u32 h = 480000;    // reset low time
+    static const u32 i = 70000;     // presence sample delay
+    static const u32 j = 410000;    // reset recovery
+};
+
+struct ONEWIRE_OVERDRIVE {
+    static const u32 a = 1000;
+    static const u32 b = 7500;
+    static const u32 c = 7500;
+    static const u32 d = 2500;
+    static const u32 e = 1000;
+    static const u32 f = 7000;
+    static const u32 g = 2500;
+    static const u32 h = 70000;
+    static const u32 i = 8500;
+    static const u32 j = 40000;
+};
+
+// ROM commands
+const u8 ONEWIRE_SEARCH_ROM = 0xF0;
+const u8 ONEWIRE_MATCH_ROM = 0x55;
+const u8 ONEWIRE_SKIP_ROM = 0xCC;
+const u8 ONEWIRE_OVERDRIVE_SKIP = 0x3C;
+const u8 ONEWIRE_OVERDRIVE_MATCH = 0x69;
+
+inline u8 onewire_crc8(const u8* data, u8 n) {
+    // Dallas/Maxim CRC-8 (x^8 + x^5 + x^4 + 1), as used in ROM codes
+    // and scratchpads. A valid block including its CRC byte gives 0.
+    u8 crc = 0;
+    while(n--) {
+        u8 value = *data++;
+        for(u8 i = 0; i < 8; i++) {
+            u8 mix = (crc ^ value) & 1;
+            crc >>= 1;
+            if(mix) {
+                crc ^= 0x8C;
+            }
+            value >>= 1;
+        }
+    }
+    return crc;
+}
+
+template <u8 pin>
+class OneWire {
+    // A 1-Wire bus master on a single OpenDrain pin.
+    // An external pullup (e.g. 4.7K to Vcc) is required.
+    //
+    // Each time slot runs with interrupts disabled, since the slave
+    // samples the line a fixed time after the falling edge.
+    // Standard and overdrive speeds are both supported; call
+    // overdrive_skip() or overdrive_select() to switch the bus
+    // to overdrive, and standard_speed() to switch back.
+    public:
+        OneWire() : overdrive(false) {
+            reset_search();
+        }
+
+        boolean reset() {
+            // Send a reset pulse at the current speed.
+            // Returns true if any device responded with a presence pulse.
+            return overdrive ? reset_slot<ONEWIRE_OVERDRIVE>() : reset_slot<ONEWIRE_STANDARD>();
+        }
+
+        void write_bit(boolean value) {
+            if(overdrive) {
+                write_slot<ONEWIRE_OVERDRIVE>(value);
+            }
+            else {
+                write_slot<ONEWIRE_STANDARD>(value);
+            }
+        }
+
+        boolean read_bit() {
+            return overdrive ? read_slot<ONEWIRE_OVERDRIVE>() : read_slot<ONEWIRE_STANDARD>();
+        }
+
+        void write(u8 value) {
+            // Send one byte, LSB first.
+            for(u8 i = 0; i < 8; i++) {
+                write_bit(value & 1);
+                value >>= 1;
+            }
+        }
+
+        u8 read() {
+            // Receive one byte, LSB first.
+            u8 value = 0;
+            for(u8 mask = 1; mask; mask <<= 1) {
+                if(read_bit()) {
+                    value |= mask;
+                }
+            }
+            return value;
+        }
+
+        void write(const u8* data, u8 n) {
+            while(n--) {
+                write(*data++);
+            }
+        }
+
+        void read(u8* data, u8 n) {
+            while(n--) {
+                *data++ = read();
+            }
+        }
+
+        void skip() {
+            // Address all devices on the bus (SKIP ROM).
+            write(ONEWIRE_SKIP_ROM);
+        }
+
+        void select(const u8 rom[8]) {
+            // Address one device by its ROM code (MATCH ROM).
+            write(ONEWIRE_MATCH_ROM);
+            write(rom, 8);
+        }
+
+        boolean overdrive_skip() {
+            // Reset the bus at standard speed, then switch all
+            // overdrive-capable devices (and this master) to overdrive.
+            // Returns true if any device was present.
+            overdrive = false;
+            if(!reset()) {
+                return false;
+            }
+            write(ONEWIRE_OVERDRIVE_SKIP);
+            overdrive = true;
+            return true;
+        }
+
+        boolean overdrive_select(const u8 rom[8]) {
+            // Reset the bus at standard speed, then switch one device
+            // to overdrive and address it. The ROM code is sent at
+            // overdrive speed.
+            overdrive = false;
+            if(!reset()) {
+                return false;
+            }
+            write(ONEWIRE_OVERDRIVE_MATCH);
+            overdrive = true;
+            write(rom, 8);
+            return true;
+        }
+
+        void standard_speed() {
+            // Return to standard speed. The next reset() is a standard
+            // speed reset, which also returns all devices to standard speed.
+            overdrive = false;
+        }
+
+        boolean is_overdrive() {
+            return overdrive;
+        }
+
+        void reset_search() {
+            last_discrepancy = 0;
+            last_device = false;
+            for(u8 i = 0; i < 8; i++) {
+                rom[i] = 0;
+            }
+        }
+
+        boolean search(u8 result[8]) {
+            // Find the next device on the bus, using the SEARCH ROM
+            // algorithm from Maxim application note 187. Call
+            // reset_search() first, then search() until it returns false.
+            // Returns false when there are no more devices, or if the
+            // ROM code read from the bus fails its CRC check.
+            if(last_device || !reset()) {
+                reset_search();
+                return false;
+            }
+
+            u8 last_zero = 0;
+            write(ONEWIRE_SEARCH_ROM);
+            for(u8 bit_number = 1; bit_number <= 64; bit_number++) {
+                u8 byte = (bit_number - 1) >> 3;
+                u8 mask = 1 << ((bit_number - 1) & 7);
+                boolean id = read_bit();
+                boolean complement = read_bit();
+                boolean direction;
+
+                if(id && complement) {
+                    // no devices are participating
+                    reset_search();
+                    return false;
+                }
+                else if(id != complement) {
+                    // all remaining devices have the same bit here
+                    direction = id;
+                }
+                else {
+                    // devices differ: take the branch chosen last time,
+                    // or the 1 branch at the last discrepancy
+                    if(bit_number < last_discrepancy) {
+                        direction = (rom[byte] & mask) != 0;
+                    }
+                    else {
+                        direction = (bit_number == last_discrepancy);
+                    }
+                    if(!direction) {
+                        last_zero = bit_number;
+                    }
+                }
+
+                if(direction) {
+                    rom[byte] |= mask;
+                }
+                else {
+                    rom[byte] &= ~mask;
+                }
+                write_bit(direction);
+            }
+
+            last_discrepancy = last_zero;
+            last_device = (last_discrepancy == 0);
+
+            if(onewire_crc8(rom, 8) != 0) {
+                reset_search();
+                return false;
+            }
+            for(u8 i = 0; i < 8; i++) {
+                result[i] = rom[i];
+            }
+            return true;
+        }
+
+    private:
+        template <class timing>
+        boolean reset_slot() {
+            boolean present;
+
+            delay_ns<timing::g>();
+            line = LOW;
+            delay_ns<timing::h>();
+            atomic {
+                line = HIGH;
+                delay_ns<timing::i>();
+                present = !line;
+            }
+            delay_ns<timing::j>();
+            return present;
+        }
+
+        template <class timing>
+        void write_slot(boolean value) {
+            atomic {
+                line = LOW;
+                if(value) {
+                    delay_ns<timing::a>();
+                    line = HIGH;
+                    delay_ns<timing::b>();
+                }
+                else {
+                    delay_ns<timing::c>();
+                    line = HIGH;
+                    delay_ns<timing::d>();
+                }
+            }
+        }
+
+        template <class timing>
+        boolean read_slot() {
+            boolean value;
+
+            atomic {
+                line = LOW;
+                delay_ns<timing::a>();
+                line = HIGH;
+                delay_ns<timing::e>();
+                value = line;
+                delay_ns<timing::f>();
+            }
+            return value;
+        }
+
+        OpenDrain<pin> line;
+        boolean overdrive;
+        u8 rom[8];
+        u8 last_discrepancy;
+        boolean last_device;
+};
+
+template <class port, u8 start_bit=0, u8 nbits=8, class timing=ONEWIRE_STANDARD>
+class OneWireBank {
+    // Up to 8 independent 1-Wire buses on adjacent pins of one port,
+    // driven in lockstep. Every slot is a single write to the port
+    // direction register, so all buses are reset, written and sampled
+    // at the same instant. Each bus needs its own pullup.
+    //
+    // The main use is enumerating many buses at once: search() runs
+    // one pass of the ROM search on every bus, choosing each bus's
+    // branch separately, so finding N devices per bus takes N passes
+    // regardless of the number of buses.
+    //
+    // Lane i of every mask corresponds to pin start_bit + i.
+    public:
+        typedef bits_type(nbits) lanes_t;
+        static const u8 lanes = nbits;
+
+        OneWireBank() {
+            reset_search();
+        }
+
+        void setup() {
+            // Release all lines; their output latches stay low, so
+            // switching a pin to output drives it low.
+            port::port_enable_inputs(mask);
+            port::port_output_clear(mask);
+        }
+
+        lanes_t reset() {
+            // Send a reset pulse on every bus.
+            // Returns a mask of the buses with a device present.
+            port_data_t sample;
+
+            delay_ns<timing::g>();
+            port::port_make_outputs(mask);
+            delay_ns<timing::h>();
+            atomic {
+                port::port_make_inputs(mask);
+                delay_ns<timing::i>();
+                sample = port::port_input_read();
+            }
+            delay_ns<timing::j>();
+            return to_lanes(~sample);
+        }
+
+        void write_bits(lanes_t lanes_active, lanes_t values) {
+            // Write one bit on each bus in lanes_active: lanes set
+            // in values write a 1, the others a 0.
+            port_data_t active = to_port(lanes_active);
+            port_data_t ones = to_port(values) & active;
+
+            atomic {
+                port::port_make_outputs(active);
+                delay_ns<timing::a>();
+                port::port_make_inputs(ones);
+                delay_ns<timing::c - timing::a>();
+                port::port_make_inputs(active);
+                delay_ns<timing::d>();
+            }
+        }
+
+        lanes_t read_bits(lanes_t lanes_active) {
+            // Read one bit from each bus in lanes_active.
+            port_data_t active = to_port(lanes_active);
+            port_data_t sample;
+
+            atomic {
+                port::port_make_outputs(active);
+                delay_ns<timing::a>();
+                port::port_make_inputs(active);
+                delay_ns<timing::e>();
+                sample = port::port_input_read();
+                delay_ns<timing::f>();
+            }
+            return to_lanes(sample) & lanes_active;
+        }
+
+        void write(u8 value, lanes_t lanes_active=all_lanes) {
+            // Send the same byte on each bus in lanes_active, e.g.
+            // SKIP ROM followed by a function command to every bus.
+            for(u8 i = 0; i < 8; i++) {
+                write_bits(lanes_active, (value & 1) ? all_lanes : 0);
+                value >>= 1;
+            }
+        }
+
+        void reset_search() {
+            finished = 0;
+            for(u8 lane = 0; lane < lanes; lane++) {
+                last_discrepancy[lane] = 0;
+            }
+        }
+
+        lanes_t search(u8 roms[][8]) {
+            // Run one pass of the ROM search on every bus that still has
+            // devices to report. roms must have one 8-byte entry per lane;
+            // the ROM code found on each bus is stored in its entry.
+            // Returns a mask of the buses that reported a device with a
+            // valid CRC. Call reset_search() first, then search() until
+            // it returns 0.
+            lanes_t active = reset() & ~finished;
+            if(!active) {
+                return 0;
+            }
+
+            u8 last_zero[nbits];
+            for(u8 lane = 0; lane < lanes; lane++) {
+                last_zero[lane] = 0;
+            }
+
+            write(ONEWIRE_SEARCH_ROM, active);
+            for(u8 bit_number = 1; bit_number <= 64; bit_number++) {
+                u8 byte = (bit_number - 1) >> 3;
+                u8 bit_mask = 1 << ((bit_number - 1) & 7);
+                lanes_t id = read_bits(active);
+                lanes_t complement = read_bits(active);
+
+                // buses where nobody answered drop out of this pass
+                lanes_t none = id & complement;
+                finished |= none;
+                active &= ~none;
+
+                // where all devices agree, follow their bit;
+                // resolve discrepancies one bus at a time
+                lanes_t direction = id & ~complement;
+                lanes_t conflict = active & ~(id | complement);
+                for(u8 lane = 0; lane < lanes; lane++) {
+                    lanes_t lane_bit = lanes_t(1) << lane;
+                    if(conflict & lane_bit) {
+                        boolean branch;
+                        if(bit_number < last_discrepancy[lane]) {
+                            branch = (roms[lane][byte] & bit_mask) != 0;
+                        }
+                        else {
+                            branch = (bit_number == last_discrepancy[lane]);
+                        }
+                        if(branch) {
+                            direction |= lane_bit;
+                        }
+                        else {
+                            last_zero[lane] = bit_number;
+                        }
+                    }
+                    if(active & lane_bit) {
+                        if(direction & lane_bit) {
+                            roms[lane][byte] |= bit_mask;
+                        }
+                        else {
+                            roms[lane][byte] &= ~bit_mask;
+                        }
+                    }
+                }
+                write_bits(active, direction);
+            }
+
+            lanes_t found = 0;
+            for(u8 lane = 0; lane < lanes; lane++) {
+                lanes_t lane_bit = lanes_t(1) << lane;
+                if(!(active & lane_bit)) {
+                    continue;
+                }
+                last_discrepancy[lane] = last_zero[lane];
+                if(last_zero[lane] == 0) {
+                    finished |= lane_bit;
+                }
+                if(onewire_crc8(roms[lane], 8) == 0) {
+                    found |= lane_bit;
+                }
+                else {
+                    // a corrupted pass can't be resumed reliably
+                    finished |= lane_bit;
+                }
+            }
+            return found;
+        }
+
+    private:
+        static const lanes_t all_lanes = lanes_t((1UL << nbits) - 1);
+        static const port_data_t mask = port_data_t(all_lanes) << start_bit;
+
+        static inline port_data_t to_port(lanes_t value) {
+            return port_data_t(value) << start_bit;
+        }
+
+        static inline lanes_t to_lanes(port_data_t value) {
+            return lanes_t(value >> start_bit) & all_lanes;
+        }
+
+        lanes_t finished;
+        u8 last_discrepancy[nbits];
+};
@@ -0,0 +1,58 @@
+#include <DirectIO.h>
+#include "DirectIO_OneWire.h"
+
+// A single 1-Wire bus on pin 2, and four more buses
+// on port D bits 4-7 (pins 4-7 on an Uno). Each line
+// needs a 4.7K pullup to Vcc.
+OneWire<2> bus;
+typedef OneWireBank<PORT_D, 4, 4> Bank;
+Bank bank;
+
+void print_rom(const u8 rom[8]) {
+  for(u8 i = 0; i < 8; i++) {
+    if(rom[i] < 0x10) {
+      Serial.print('0');
+    }
+    Serial.print(rom[i], HEX);
+  }
+  Serial.println();
+}
+
+void setup() {
+  Serial.begin(9600);
+  bank.setup();
+}
+
+void loop() {
+  u8 rom[8];
+
+  Serial.println("pin 2:");
+  bus.reset_search();
+  while(bus.search(rom)) {
+    print_rom(rom);
+  }
+
+  // Enumerate all four buses at once; each pass
+  // finds the next device on every bus.
+  u8 roms[Bank::lanes][8];
+  Bank::lanes_t found;
+
+  bank.reset_search();
+  while((found = bank.search(roms)) != 0) {
+    for(u8 lane = 0; lane < Bank::lanes; lane++) {
+      if(found & (1 << lane)) {
+        Serial.print("pin ");
+        Serial.print(4 + lane);
+        Serial.print(": ");
+        print_rom(roms[lane]);
+      }
+    }
+  }
+
+  // Start a temperature conversion on every DS18B20 on every bus
+  if(bank.reset()) {
+    bank.write(ONEWIRE_SKIP_ROM);
+    bank.write(0x44);
+  }
+  delay(1000);
+}
@@ -0,0 +1,117 @@
+/*
+  DirectIO_Quadrature.h - Quadrature encoder decoder using Direct IO library
+  Copyright (c) 2015-2018 Michael Marchetti.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <DirectIO.h>
+
+#if defined(DIRECTIO_FALLBACK)
+#error "QuadratureDecoder requires direct I/O support (AVR, SAM or SAMD boards)"
+#endif
+
+// Count change for each transition of an encoder's (B, A) state,
+// indexed by old state * 4 + new state. A change of both lines
+// at once is an error, and is not counted.
+const i8 _quadrature_steps[16] = {
+     0, +1, -1,  0,
+    -1,  0,  0, +1,
+    +1,  0,  0, -1,
+     0, -1, +1,  0
+};
+
+template <class input_port, u8 encoders>
+class QuadratureDecoder {
+    // Decodes up to 4 quadrature encoders on an 8 bit port (8 on a
+    // 16 bit port), all read at once. Encoder i uses port bits 2i (A)
+    // and 2i + 1 (B). Counts change by one on every edge of either line
+    // (4 counts per encoder cycle), up when A leads B.
+    //
+    // Call update() from a pin change interrupt on the encoder lines,
+    // or from a timer interrupt at more than twice the highest edge
+    // rate. Each call reads the port once; only the encoders whose
+    // lines changed are looked up in the transition table. If both
+    // lines of an encoder change between two calls, an edge was missed;
+    // this is reported by errors().
+    public:
+        typedef bits_type(encoders) encoders_t;
+
+        QuadratureDecoder() : last(0), missed(0) {
+            for(u8 i = 0; i < encoders; i++) {
+                counts[i] = 0;
+            }
+        }
+
+        void setup() {
+            // encoders with open collector outputs need pullup resistors
+            port.setup();
+            last = port.read();
+        }
+
+        void update() {
+            port_data_t now = port.read();
+            port_data_t changed = now ^ last;
+            if(!changed) {
+                return;
+            }
+            for(u8 i = 0; i < encoders; i++) {
+                u8 shift = 2 * i;
+                if(changed & (port_data_t(3) << shift)) {
+                    u8 index = (((last >> shift) & 3) << 2) | ((now >> shift) & 3);
+                    i8 step = _quadrature_steps[index];
+                    if(step) {
+                        counts[i] += step;
+                    }
+                    else {
+                        missed |= encoders_t(1) << i;
+                    }
+                }
+            }
+            last = now;
+        }
+
+        i32 read(u8 encoder) {
+            i32 value;
+            atomic {
+                value = counts[encoder];
+            }
+            return value;
+        }
+
+        void write(u8 encoder, i32 value) {
+            atomic {
+                counts[encoder] = value;
+            }
+        }
+
+        encoders_t errors() {
+            // encoders that missed an edge since the last call
+            encoders_t value;
+            atomic {
+                value = missed;
+                missed = 0;
+            }
+            return value;
+        }
+
+    private:
+        static_assert(2 * encoders <= input_port::width, "input_port needs 2 bits per encoder");
+
+        input_port port;
+        port_data_t last;
+        volatile i32 counts[encoders];
+        volatile encoders_t missed;
+};
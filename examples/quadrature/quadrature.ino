@@ -0,0 +1,35 @@
+#include <DirectIO.h>
+#include "DirectIO_Quadrature.h"
+
+// Decode two quadrature encoders on port C bits 0-3
+// (A0-A3 on an Uno: A0 and A1 for the first, A2 and A3 for the second),
+// updating from the pin change interrupt for those pins.
+QuadratureDecoder<InputPort<PORT_C, 0, 4>, 2> encoders;
+
+void setup() {
+  Serial.begin(115200);
+  encoders.setup();
+
+  // pin change interrupt on PCINT8-11 (A0-A3)
+  noInterrupts();
+  PCMSK1 = 0x0F;
+  PCICR |= _BV(PCIE1);
+  interrupts();
+}
+
+ISR(PCINT1_vect) {
+  encoders.update();
+}
+
+void loop() {
+  Serial.print(encoders.read(0));
+  Serial.print(' ');
+  Serial.println(encoders.read(1));
+
+  u8 errors = encoders.errors();
+  if(errors) {
+    Serial.print("missed edges: ");
+    Serial.println(errors, BIN);
+  }
+  delay(100);
+}
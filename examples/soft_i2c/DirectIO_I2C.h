@@ -0,0 +1,223 @@
+/*
+  DirectIO_I2C.h - Bit-banged I2C master using Direct IO library
+  Copyright (c) 2015-2018 Michael Marchetti.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <DirectIO.h>
+
+// Bus timing for each I2C speed grade, in nanoseconds.
+// Values are the minimums from the I2C specification (NXP UM10204);
+// t_r is the maximum SCL rise time allowed before clock stretching is checked.
+struct I2C_STANDARD {
+    // 100 KHz
+    static const u16 t_low    = 4700;   // SCL low period
+    static const u16 t_high   = 4000;   // SCL high period
+    static const u16 t_su_sta = 4700;   // repeated START setup time
+    static const u16 t_hd_sta = 4000;   // START hold time
+    static const u16 t_su_sto = 4000;   // STOP setup time
+    static const u16 t_buf    = 4700;   // bus free time between STOP and START
+    static const u16 t_r      = 1000;
+};
+
+struct I2C_FAST {
+    // 400 KHz
+    static const u16 t_low    = 1300;
+    static const u16 t_high   = 600;
+    static const u16 t_su_sta = 600;
+    static const u16 t_hd_sta = 600;
+    static const u16 t_su_sto = 600;
+    static const u16 t_buf    = 1300;
+    static const u16 t_r      = 300;
+};
+
+struct I2C_FAST_PLUS {
+    // 1 MHz
+    static const u16 t_low    = 500;
+    static const u16 t_high   = 260;
+    static const u16 t_su_sta = 260;
+    static const u16 t_hd_sta = 260;
+    static const u16 t_su_sto = 260;
+    static const u16 t_buf    = 500;
+    static const u16 t_r      = 120;
+};
+
+template <u8 sda_pin, u8 scl_pin, class timing=I2C_FAST>
+class SoftI2C {
+    // A bit-banged I2C master. SDA and SCL are OpenDrain pins,
+    // so each bus transition is a single write to the pin direction
+    // register. External pullups are required on both lines.
+    //
+    // Slaves may stretch the clock by holding SCL low; if SCL is
+    // held longer than stretch_timeout microseconds, the transfer
+    // is abandoned, both lines are released and timed_out() returns true.
+    public:
+        SoftI2C(u16 stretch_timeout=1000) :
+            stretch_timeout(stretch_timeout), active(false), timeout(false) {}
+
+        boolean start(u8 address, boolean read=false) {
+            // Send a START (or a repeated START, if a transfer is
+            // already in progress) followed by the 7-bit address.
+            // Returns true if the slave acknowledged.
+            timeout = false;
+            if(active) {
+                sda = HIGH;
+                delay_ns<timing::t_low>();
+                if(!clock_high()) {
+                    return false;
+                }
+                delay_ns<timing::t_su_sta>();
+            }
+            sda = LOW;
+            delay_ns<timing::t_hd_sta>();
+            scl = LOW;
+            active = true;
+            return write(u8((address << 1) | (read ? 1 : 0)));
+        }
+
+        void stop() {
+            if(!active) {
+                return;
+            }
+            sda = LOW;
+            delay_ns<timing::t_low>();
+            if(clock_high()) {
+                delay_ns<timing::t_su_sto>();
+                sda = HIGH;
+                delay_ns<timing::t_buf>();
+            }
+            active = false;
+        }
+
+        boolean write(u8 value) {
+            // Send one byte, MSB first. Returns true if the slave acknowledged.
+            for(u8 mask = 0x80; mask; mask >>= 1) {
+                sda = (value & mask) != 0;
+                if(!clock_bit()) {
+                    return false;
+                }
+            }
+
+            // release SDA so the slave can acknowledge
+            sda = HIGH;
+            delay_ns<timing::t_low>();
+            if(!clock_high()) {
+                return false;
+            }
+            boolean ack = !sda;
+            delay_ns<timing::t_high>();
+            scl = LOW;
+            return ack;
+        }
+
+        u8 read(boolean ack=true) {
+            // Receive one byte, MSB first. Set ack to false
+            // for the last byte of a read.
+            u8 value = 0;
+
+            sda = HIGH;
+            for(u8 i = 0; i < 8; i++) {
+                delay_ns<timing::t_low>();
+                if(!clock_high()) {
+                    return 0;
+                }
+                value = (value << 1) | (sda ? 1 : 0);
+                delay_ns<timing::t_high>();
+                scl = LOW;
+            }
+
+            sda = !ack;
+            if(!clock_bit()) {
+                return 0;
+            }
+            sda = HIGH;
+            return value;
+        }
+
+        boolean write(u8 address, const u8* data, u16 n, boolean send_stop=true) {
+            // Write a block of bytes to a slave. Pass send_stop=false to
+            // keep the bus for a following read (e.g. after sending a
+            // register number); the next start() will be a repeated START.
+            boolean ok = start(address, false);
+            while(ok && n--) {
+                ok = write(*data++);
+            }
+            if(send_stop || !ok) {
+                stop();
+            }
+            return ok;
+        }
+
+        boolean read(u8 address, u8* data, u16 n, boolean send_stop=true) {
+            // Read a block of bytes from a slave, acknowledging all but the last.
+            boolean ok = start(address, true);
+            while(ok && n--) {
+                *data++ = read(n != 0);
+                ok = !timeout;
+            }
+            if(send_stop || !ok) {
+                stop();
+            }
+            return ok;
+        }
+
+        boolean timed_out() {
+            // true if the last transfer was abandoned due to clock stretching
+            return timeout;
+        }
+
+    private:
+        boolean clock_high() {
+            // Release SCL and wait for it to rise.
+            // Returns false if a slave stretches the clock past the timeout.
+            scl = HIGH;
+            delay_ns<timing::t_r>();
+            if(!scl) {
+                u32 begin = micros();
+                while(!scl) {
+                    if(micros() - begin > stretch_timeout) {
+                        abort();
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        boolean clock_bit() {
+            // clock out the bit currently on SDA
+            delay_ns<timing::t_low>();
+            if(!clock_high()) {
+                return false;
+            }
+            delay_ns<timing::t_high>();
+            scl = LOW;
+            return true;
+        }
+
+        void abort() {
+            sda = HIGH;
+            scl = HIGH;
+            active = false;
+            timeout = true;
+        }
+
+        OpenDrain<sda_pin> sda;
+        OpenDrain<scl_pin> scl;
+        u16 stretch_timeout;
+        boolean active;
+        boolean timeout;
+};
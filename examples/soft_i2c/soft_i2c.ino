@@ -0,0 +1,31 @@
+#include <DirectIO.h>
+#include "DirectIO_I2C.h"
+
+// I2C bus with SDA on pin 2 and SCL on pin 3, at 400 KHz.
+// Both lines need pullup resistors (e.g. 4.7K to Vcc).
+SoftI2C<2, 3, I2C_FAST> i2c;
+
+// read the WHO_AM_I register of an MPU-6050
+const u8 device = 0x68;
+const u8 who_am_i = 0x75;
+
+void setup() {
+  Serial.begin(9600);
+}
+
+void loop() {
+  u8 id;
+
+  // write the register number without a STOP, then read it back
+  // using a repeated START.
+  if(i2c.write(device, &who_am_i, 1, false) && i2c.read(device, &id, 1)) {
+    Serial.println(id, HEX);
+  }
+  else if(i2c.timed_out()) {
+    Serial.println("clock stretch timeout");
+  }
+  else {
+    Serial.println("no response");
+  }
+  delay(1000);
+}
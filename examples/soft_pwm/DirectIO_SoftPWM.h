@@ -0,0 +1,257 @@
+/*
+  DirectIO_SoftPWM.h - Multi-channel software PWM using Direct IO library
+  Copyright (c) 2015-2018 Michael Marchetti.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <DirectIO.h>
+
+#if defined(DIRECTIO_FALLBACK)
+#error "SoftPWM requires direct I/O support (AVR, SAM or SAMD boards)"
+#endif
+
+template <u8... pins>
+class SoftPWM {
+    // 8 bit PWM on any number of pins, driven by a timer interrupt that
+    // runs only when some output changes. A period is 256 ticks: every
+    // channel with a duty above 0 turns on at tick 0, and turns off at
+    // tick duty (255 stays on).
+    //
+    // update() sorts the channels by duty and builds a schedule of
+    // events: the tick of each distinct duty, and for each port with a
+    // channel changing at that tick, the bits to set and clear. So the
+    // interrupt handles each port with one store per event, no matter
+    // how many channels it has.
+    //
+    // Schedules are double buffered: update() builds the next one while
+    // the current one runs, and it takes effect at the start of the next
+    // period, so no period is ever cut short or doubled.
+    //
+    // Call tick() from a timer interrupt. It returns the number of ticks
+    // to the next event; the timer period should be set to that many
+    // ticks before the next call. A tick must be longer than tick()
+    // takes to run.
+    public:
+        static const u8 channels = sizeof...(pins);
+
+        SoftPWM() : front(0), pending(false), event(0) {
+            for(u8 i = 0; i < channels; i++) {
+                duty[i] = 0;
+            }
+            for(u8 b = 0; b < 2; b++) {
+                buffer[b].events = 0;
+                buffer[b].time[0] = 0;
+                buffer[b].end[0] = 0;
+            }
+        }
+
+        void setup() {
+            // set all the pins to outputs, LOW, and group them by port
+            const u8 pin_numbers[] = { pins... };
+#if defined(ARDUINO_ARCH_AVR)
+            const u16 addresses[] = { _pins<pins>::out... };
+            const port_data_t masks[] = { port_data_t(1 << _pins<pins>::bit)... };
+#else
+            const port_fn set_fns[] = { &_pins<pins>::port_output_set... };
+            const port_fn clear_fns[] = { &_pins<pins>::port_output_clear... };
+            const port_data_t masks[] = { port_data_t(_pins<pins>::mask)... };
+#endif
+
+            ports = 0;
+            for(u8 i = 0; i < channels; i++) {
+                pinMode(pin_numbers[i], OUTPUT);
+                digitalWrite(pin_numbers[i], LOW);
+
+                u8 p = 0;
+#if defined(ARDUINO_ARCH_AVR)
+                while(p < ports && out[p] != port_t(addresses[i])) {
+                    p++;
+                }
+                out[p] = port_t(addresses[i]);
+#else
+                while(p < ports && set[p] != set_fns[i]) {
+                    p++;
+                }
+                set[p] = set_fns[i];
+                clear[p] = clear_fns[i];
+#endif
+                if(p == ports) {
+                    ports++;
+                }
+                channel_port[i] = p;
+                channel_mask[i] = masks[i];
+            }
+        }
+
+        void write(u8 channel, u8 value) {
+            // Set a channel's duty; it takes effect at the next update().
+            duty[channel] = value;
+        }
+
+        u8 read(u8 channel) {
+            return duty[channel];
+        }
+
+        void update() {
+            // Build a schedule from the current duties. If the last one
+            // hasn't started yet, this waits for it (at most one period).
+            while(pending) {}
+
+            schedule& s = buffer[front ^ 1];
+
+            // sort the channels by duty
+            u8 order[channels];
+            for(u8 i = 0; i < channels; i++) {
+                u8 j = i;
+                while(j > 0 && duty[order[j - 1]] > duty[i]) {
+                    order[j] = order[j - 1];
+                    j--;
+                }
+                order[j] = i;
+            }
+
+            // tick 0: turn on every channel above 0, and off the rest
+            u8 n = 0;
+            s.time[0] = 0;
+            for(u8 p = 0; p < ports; p++) {
+                port_data_t on = 0;
+                port_data_t off = 0;
+                for(u8 i = 0; i < channels; i++) {
+                    if(channel_port[i] == p) {
+                        if(duty[i]) {
+                            on |= channel_mask[i];
+                        }
+                        else {
+                            off |= channel_mask[i];
+                        }
+                    }
+                }
+                n = add(s, n, 0, p, on, off);
+            }
+            s.end[0] = n;
+
+            // then turn each channel off at its duty, in order
+            u8 e = 0;
+            for(u8 k = 0; k < channels; k++) {
+                u8 i = order[k];
+                if(duty[i] == 0 || duty[i] == 255) {
+                    continue;
+                }
+                if(duty[i] != s.time[e]) {
+                    e++;
+                    s.time[e] = duty[i];
+                }
+                n = add(s, n, s.end[e - 1], channel_port[i], 0, channel_mask[i]);
+                s.end[e] = n;
+            }
+            s.events = e;
+
+            pending = true;
+        }
+
+        u16 tick() {
+            const schedule& s = buffer[front];
+            for(u8 j = event ? s.end[event - 1] : 0; j < s.end[event]; j++) {
+                apply(s.port[j], s.on[j], s.off[j]);
+            }
+
+            u8 now = s.time[event];
+            if(event < s.events) {
+                event++;
+                return s.time[event] - now;
+            }
+
+            // the end of the period: switch to the next schedule, if any
+            event = 0;
+            if(pending) {
+                front ^= 1;
+                pending = false;
+            }
+            return 256 - now;
+        }
+
+    private:
+        struct schedule {
+            // event e happens at time[e] and applies entries
+            // end[e - 1] to end[e] - 1 (event 0 starts at entry 0)
+            u8 events;
+            u8 time[channels + 1];
+            u8 end[channels + 1];
+            u8 port[2 * channels];
+            port_data_t on[2 * channels];
+            port_data_t off[2 * channels];
+        };
+
+        static u8 add(schedule& s, u8 n, u8 first, u8 p, port_data_t on, port_data_t off) {
+            // merge into the current event's entry for port p,
+            // or add one; returns the number of entries
+            if(!(on | off)) {
+                return n;
+            }
+            for(u8 j = first; j < n; j++) {
+                if(s.port[j] == p) {
+                    s.on[j] |= on;
+                    s.off[j] |= off;
+                    return n;
+                }
+            }
+            s.port[n] = p;
+            s.on[n] = on;
+            s.off[n] = off;
+            return n + 1;
+        }
+
+#if defined(ARDUINO_ARCH_AVR)
+        inline void apply(u8 p, port_data_t on, port_data_t off) {
+            // Output and OutputPort change ports below 0x40 with single
+            // sbi/cbi instructions or inside atomic blocks, so tick()
+            // can't undo their changes. Output on higher ports (e.g.
+            // Mega ports H-L) uses a plain load and store; don't mix
+            // those with PWM pins on the same port unless the writes
+            // are made with interrupts off.
+            port_t o = out[p];
+            *o = (*o & ~off) | on;
+        }
+#else
+        typedef void (*port_fn)(port_data_t);
+
+        inline void apply(u8 p, port_data_t on, port_data_t off) {
+            if(on) {
+                set[p](on);
+            }
+            if(off) {
+                clear[p](off);
+            }
+        }
+#endif
+
+        u8 duty[channels];
+        u8 channel_port[channels];
+        port_data_t channel_mask[channels];
+
+        u8 ports;
+#if defined(ARDUINO_ARCH_AVR)
+        port_t out[channels];
+#else
+        port_fn set[channels];
+        port_fn clear[channels];
+#endif
+
+        schedule buffer[2];
+        volatile u8 front;
+        volatile boolean pending;
+        u8 event;
+};
@@ -0,0 +1,38 @@
+#include <DirectIO.h>
+#include "DirectIO_SoftPWM.h"
+
+// 12 channels of software PWM on pins 2-13 of an Uno, updated from
+// Timer1. Each channel ramps up and down at a different rate.
+SoftPWM<2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13> pwm;
+
+// CPU cycles per PWM tick: 256 ticks make a period of
+// 65536 cycles (244 Hz at 16 MHz).
+const u16 unit = 256;
+
+void setup() {
+  pwm.setup();
+  pwm.update();
+
+  // Timer1 in CTC mode, no prescaler
+  noInterrupts();
+  TCCR1A = 0;
+  TCCR1B = _BV(WGM12) | _BV(CS10);
+  OCR1A = unit - 1;
+  TIMSK1 = _BV(OCIE1A);
+  interrupts();
+}
+
+ISR(TIMER1_COMPA_vect) {
+  OCR1A = pwm.tick() * unit - 1;
+}
+
+void loop() {
+  static u16 phase = 0;
+  for(u8 i = 0; i < pwm.channels; i++) {
+    u8 x = (phase * (i + 1)) >> 4;
+    pwm.write(i, (x < 128) ? x * 2 : (255 - x) * 2);
+  }
+  pwm.update();
+  phase++;
+  delay(5);
+}
@@ -0,0 +1,185 @@
+/*
+  DirectIO_SoftQSPI.h - Bit-banged quad SPI flash reader using Direct IO library
+  Copyright (c) 2015-2018 Michael Marchetti.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <DirectIO.h>
+
+#if defined(DIRECTIO_FALLBACK)
+#error "SoftQSPI requires direct I/O support (AVR, SAM or SAMD boards)"
+#endif
+
+template <class data_port, u8 sck_pin, u8 cs_pin, u8 dummy_clocks=4>
+class SoftQSPI {
+    // Reads SPI NOR flash over four data lines (IO0-IO3), in SPI mode 0.
+    // data_port is a 4 bit BiDirectionalPort, with IO0 in its lowest bit.
+    //
+    // read() uses the Fast Read Quad I/O command (0xEB): the address,
+    // mode byte and data move a nibble per clock, so a byte takes two
+    // clocks instead of eight. The data loop reads the port once per
+    // nibble and is unrolled over pairs of bytes.
+    //
+    // Other commands use a single lane: IO0 is the data input to the
+    // flash, IO1 its output, and IO2 and IO3 (WP# and HOLD# until quad
+    // mode is enabled) are held high. The flash's quad enable (QE)
+    // bit must be set before quad reads; enable_quad() sets it on
+    // Winbond, GigaDevice and similar parts, where it is bit 1 of
+    // status register 2. dummy_clocks is the number of dummy clocks
+    // after the mode byte (4 for most parts at their default setting).
+    public:
+        SoftQSPI() : sck(LOW), cs(HIGH) {
+            single_lane();
+        }
+
+        u32 read_id() {
+            // the JEDEC manufacturer and device ID (command 0x9F)
+            select();
+            send(0x9F);
+            u32 id = receive();
+            id = (id << 8) | receive();
+            id = (id << 8) | receive();
+            deselect();
+            return id;
+        }
+
+        u8 read_status(u8 command=0x05) {
+            // a status register (0x05, 0x35 or 0x15 on most parts)
+            select();
+            send(command);
+            u8 value = receive();
+            deselect();
+            return value;
+        }
+
+        void enable_quad() {
+            // set the QE bit (non-volatile), if it isn't set already,
+            // keeping the other bits of status register 2
+            u8 status = read_status(0x35);
+            if(status & 0x02) {
+                return;
+            }
+            select();
+            send(0x06);
+            deselect();
+            select();
+            send(0x31);
+            send(status | 0x02);
+            deselect();
+            while(read_status() & 0x01) {}
+        }
+
+        void read(u32 address, u8* buffer, u32 n) {
+            select();
+            send(0xEB);
+
+            // address, and a mode byte that doesn't enter continuous read
+            data.make_output();
+            write_nibble(address >> 20);
+            write_nibble(address >> 16);
+            write_nibble(address >> 12);
+            write_nibble(address >> 8);
+            write_nibble(address >> 4);
+            write_nibble(address);
+            write_nibble(0xF);
+            write_nibble(0xF);
+
+            // turn the bus around while the flash counts the dummy clocks
+            data.make_input();
+            for(u8 i = 0; i < dummy_clocks; i++) {
+                clock();
+            }
+
+            u32 pairs = n / 2;
+            while(pairs--) {
+                buffer[0] = read_byte();
+                buffer[1] = read_byte();
+                buffer += 2;
+            }
+            if(n & 1) {
+                *buffer = read_byte();
+            }
+
+            deselect();
+            single_lane();
+        }
+
+    private:
+        typedef typename data_port::port_type port;
+
+        static_assert(data_port::width == 4, "SoftQSPI needs a 4 bit data port");
+
+        void select() {
+            cs = LOW;
+        }
+
+        void deselect() {
+            cs = HIGH;
+        }
+
+        inline void clock() {
+            // the flash samples on the rising edge and changes
+            // its output on the falling edge
+            sck = HIGH;
+            sck = LOW;
+        }
+
+        void single_lane() {
+            // IO0, IO2 and IO3 high outputs; IO1 an input
+            data.write(0x0F);
+            data.make_output();
+            port::port_make_inputs(port_data_t(2) << data_port::first_bit);
+        }
+
+        void send(u8 value) {
+            for(u8 i = 0; i < 8; i++) {
+                data.write((value & 0x80) ? 0x0F : 0x0E);
+                value <<= 1;
+                clock();
+            }
+        }
+
+        u8 receive() {
+            u8 value = 0;
+            for(u8 i = 0; i < 8; i++) {
+                value = (value << 1) | ((data.read() >> 1) & 1);
+                clock();
+            }
+            return value;
+        }
+
+        void write_nibble(u8 value) {
+            data.write(value & 0x0F);
+            clock();
+        }
+
+        static inline u8 read_nibble() {
+            return (port::port_input_read() & data_port::mask) >> data_port::first_bit;
+        }
+
+        inline u8 read_byte() {
+            // high nibble first
+            u8 value = read_nibble() << 4;
+            clock();
+            value |= read_nibble();
+            clock();
+            return value;
+        }
+
+        data_port data;
+        Output<sck_pin> sck;
+        Output<cs_pin> cs;
+};
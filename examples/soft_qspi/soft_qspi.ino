@@ -0,0 +1,35 @@
+#include <DirectIO.h>
+#include "DirectIO_SoftQSPI.h"
+
+// A quad SPI NOR flash (e.g. W25Q32) with IO0-IO3 on port C bits 0-3
+// (A0-A3 on an Uno), SCK on pin 2 and CS# on pin 3. The flash runs
+// at 3.3V: use a 3.3V board, or level shifters on every line.
+SoftQSPI<BiDirectionalPort<PORT_C, 0, 4>, 2, 3> flash;
+
+u8 buffer[512];
+
+void setup() {
+  Serial.begin(115200);
+
+  Serial.print("JEDEC ID: ");
+  Serial.println(flash.read_id(), HEX);
+  flash.enable_quad();
+
+  u32 start = micros();
+  for(u32 address = 0; address < 8192; address += sizeof(buffer)) {
+    flash.read(address, buffer, sizeof(buffer));
+  }
+  u32 elapsed = micros() - start;
+  Serial.print("Read 8 KB in ");
+  Serial.print(elapsed);
+  Serial.println(" us");
+
+  for(u8 i = 0; i < 16; i++) {
+    Serial.print(buffer[i], HEX);
+    Serial.print(' ');
+  }
+  Serial.println();
+}
+
+void loop() {
+}
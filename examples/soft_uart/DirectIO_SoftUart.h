@@ -0,0 +1,186 @@
+/*
+  DirectIO_SoftUart.h - Bit-banged UART transmitter using Direct IO library
+  Copyright (c) 2015-2018 Michael Marchetti.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <DirectIO.h>
+
+#if defined(DIRECTIO_FALLBACK)
+#error "SoftUartTx requires direct I/O support (AVR, SAM or SAMD boards)"
+#endif
+
+template <u8 pin, u32 baud>
+class SoftUartTx : public Print {
+    // A bit-banged UART transmitter (8 data bits, no parity, 1 stop bit).
+    // Every bit edge is placed at a cycle count computed at compile time
+    // from F_CPU and the baud rate, so timing errors don't accumulate
+    // across the byte. Interrupts are disabled while each byte is sent,
+    // and re-enabled between bytes.
+    //
+    // On AVR, the bit sequence is fully unrolled and each edge is a single
+    // port store, reaching 2 Mbaud at 16 MHz. On SAM and SAMD51 boards,
+    // edges are timed against the DWT cycle counter. SAMD21 boards have
+    // no cycle counter, so their bit times are open loop: each bit may be
+    // off by a few cycles (flash wait states, APB store latency), and
+    // the error adds up over the 10 bits. Allow for up to about 4 cycles
+    // per bit: under 1% at 115200 baud on a 48 MHz SAMD21, but keep to
+    // about 250 kbaud there to stay inside a receiver's tolerance.
+    public:
+        SoftUartTx() : out(HIGH) {}
+
+        virtual size_t write(uint8_t value) {
+            atomic {
+                send(value);
+            }
+            return 1;
+        }
+
+        virtual size_t write(const uint8_t* data, size_t n) {
+            // send a block of bytes, allowing interrupts between bytes
+            for(size_t i = 0; i < n; i++) {
+                write(data[i]);
+            }
+            return n;
+        }
+
+        using Print::write;
+
+    private:
+        template <u8 k> struct edge {
+            // cycles from the start of the start bit to the start of bit k
+            static const u32 cycles = u32(((unsigned long long)(k) * F_CPU + baud / 2) / baud);
+        };
+
+#if defined(DIRECTIO_CYCLE_COUNTER)
+        void send(u8 value) {
+            // bit time in 1/256 cycle units
+            const u32 bit_time = u32(((unsigned long long)(F_CPU) * 256 + baud / 2) / baud);
+
+            cycle_counter_setup();
+            u32 start = cycle_count();
+            u32 t = bit_time;
+
+            out = LOW;
+            for(u8 i = 0; i < 8; i++) {
+                wait_cycles(start, t >> 8);
+                out = (value & 1) != 0;
+                value >>= 1;
+                t += bit_time;
+            }
+            wait_cycles(start, t >> 8);
+            out = HIGH;
+            t += bit_time;
+            wait_cycles(start, t >> 8);
+        }
+#else
+        // AVR and Cortex-M0+: the bits are unrolled, with compile-time
+        // delays between the port stores. store_cycles is the length of
+        // the store instruction, and data_cycles is the time needed to
+        // prepare a data bit before storing it.
+#if defined(ARDUINO_ARCH_AVR)
+        static const u8 store_cycles = (_pins<pin>::out < 0x60) ? 1 : 2;
+        static const u8 data_cycles = 2;
+
+        static port_data_t latch() {
+            return *port_t(_pins<pin>::out);
+        }
+
+        static inline void store(u8 v) {
+            __asm__ __volatile__ (
+                ".if %[addr] < 0x60         \n"
+                "   out %[addr] - 0x20, %[v] \n"
+                ".else                      \n"
+                "   sts %[addr], %[v]        \n"
+                ".endif                     \n"
+                :
+                : [v] "r" (v), [addr] "n" (_pins<pin>::out)
+            );
+        }
+
+        template <u8 k>
+        static inline void data_bit(u8 value, u8 v) {
+            // copy bit k of value into the port bit, then store
+            __asm__ __volatile__ (
+                "bst %[value], %[k]          \n"
+                "bld %[v], %[bit]            \n"
+                ".if %[addr] < 0x60         \n"
+                "   out %[addr] - 0x20, %[v] \n"
+                ".else                      \n"
+                "   sts %[addr], %[v]        \n"
+                ".endif                     \n"
+                : [v] "+r" (v)
+                : [value] "r" (value), [k] "n" (k),
+                  [bit] "n" (_pins<pin>::bit), [addr] "n" (_pins<pin>::out)
+            );
+        }
+#else
+        // estimates for Cortex-M0+; wait states and bus latency vary
+        static const u8 store_cycles = 2;
+        static const u8 data_cycles = 4;
+
+        static port_data_t latch() {
+            return _pins<pin>::port_output_read();
+        }
+
+        static inline void store(port_data_t v) {
+            _pins<pin>::port_output_write(v);
+        }
+
+        template <u8 k>
+        static inline void data_bit(u8 value, port_data_t v) {
+            store(v | (port_data_t((value >> k) & 1) << _pins<pin>::bit));
+        }
+#endif
+
+        template <u8 k, u8 prepare_cycles>
+        struct gap {
+            // delay after the store for bit k, so that the next store lands on bit k+1
+            static const u32 cycles = edge<k + 1>::cycles - edge<k>::cycles - store_cycles - prepare_cycles;
+        };
+
+        static_assert(F_CPU / baud >= store_cycles + data_cycles, "baud rate is too high for this CPU clock");
+
+        void send(u8 value) {
+            const port_data_t mask = port_data_t(1) << _pins<pin>::bit;
+            port_data_t hi = latch() | mask;
+            port_data_t lo = hi & ~mask;
+
+            store(lo);
+            delay_cycles<gap<0, data_cycles>::cycles>();
+            data_bit<0>(value, lo);
+            delay_cycles<gap<1, data_cycles>::cycles>();
+            data_bit<1>(value, lo);
+            delay_cycles<gap<2, data_cycles>::cycles>();
+            data_bit<2>(value, lo);
+            delay_cycles<gap<3, data_cycles>::cycles>();
+            data_bit<3>(value, lo);
+            delay_cycles<gap<4, data_cycles>::cycles>();
+            data_bit<4>(value, lo);
+            delay_cycles<gap<5, data_cycles>::cycles>();
+            data_bit<5>(value, lo);
+            delay_cycles<gap<6, data_cycles>::cycles>();
+            data_bit<6>(value, lo);
+            delay_cycles<gap<7, data_cycles>::cycles>();
+            data_bit<7>(value, lo);
+            delay_cycles<gap<8, 0>::cycles>();
+            store(hi);
+            delay_cycles<gap<9, 0>::cycles>();
+        }
+#endif
+
+        Output<pin> out;
+};
@@ -0,0 +1,25 @@
+#include <DirectIO.h>
+#include "DirectIO_SoftUart.h"
+
+// A 1 Mbaud telemetry channel on pin 2.
+// Connect pin 2 to the RX pin of a USB serial adapter.
+SoftUartTx<2, 1000000> telemetry;
+
+u8 packet[16];
+
+void setup() {
+  telemetry.println("DirectIO SoftUartTx");
+}
+
+void loop() {
+  static u8 sequence = 0;
+
+  for(u8 i = 0; i < sizeof(packet); i++) {
+    packet[i] = sequence + i;
+  }
+  sequence++;
+
+  // interrupts are only disabled while each byte is being sent
+  telemetry.write(packet, sizeof(packet));
+  delay(10);
+}
@@ -0,0 +1,272 @@
+/*
+  DirectIO_StepperBank.h - Coordinated stepper motor pulse generator using Direct IO library
+  Copyright (c) 2015-2018 Michael Marchetti.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <DirectIO.h>
+
+#if defined(DIRECTIO_FALLBACK)
+#error "StepperBank requires direct I/O support (AVR, SAM or SAMD boards)"
+#endif
+
+template <class step_port, class dir_port, u8 axes, u8 queue_size=8, u16 ramp_size=256>
+class StepperBank {
+    // Generates coordinated STEP/DIR signals for up to 8 stepper motor
+    // axes (up to 32 on SAM/SAMD). The STEP lines of all axes are on
+    // step_port and the DIR lines on dir_port, so the steps of every
+    // axis due at the same time are started with one port write.
+    //
+    // Moves are queued as segments: a number of steps for each axis,
+    // and a top speed for the axis with the most steps. Within a
+    // segment, the other axes are stepped along with it by Bresenham's
+    // line algorithm (DDA).
+    //
+    // Speeds are kept as an index into a table of step intervals for
+    // constant acceleration from rest, computed once by setup(): speed
+    // index n is the speed reached after n steps. So a speed change of
+    // k steps of acceleration is just k table entries, and the look-ahead
+    // planner only adds and compares step counts. The table has
+    // ramp_size entries, which caps the speed at sqrt(2 * a * ramp_size)
+    // steps per second for an acceleration a. Whenever a segment is
+    // added, the queue is re-planned so that every segment can slow
+    // down to its exit speed in time, and the last one stops. Segments
+    // that continue in the same direction on the same axes are joined
+    // without stopping; any other change of direction stops first.
+    //
+    // Call tick() from a timer interrupt. It returns the number of timer
+    // ticks to the next call. Each call ends the previous STEP pulses,
+    // then starts the next ones, so the pulse lasts until the next call
+    // and the low time is the time tick() takes to pick the next axes
+    // (a few microseconds; stepper drivers need 1-2 us).
+    public:
+        typedef bits_type(axes) axes_t;
+
+        // ticks between calls while idle
+        static const u16 idle_interval = 1000;
+
+        StepperBank() : acceleration(1), head(0), tail(0), active(false), speed(0), dirs(0) {}
+
+        void setup(u32 timer_rate, u32 accel) {
+            // Compute the acceleration table, for a timer of timer_rate
+            // ticks per second and an acceleration in steps/s^2.
+            // Step n of an acceleration from rest is taken at
+            // sqrt(2n / a) seconds.
+            step_out.write(0);
+            dir_out.write(0);
+            acceleration = accel;
+            float c0 = timer_rate * sqrt(2.0 / accel);
+            for(u16 n = 0; n < ramp_size; n++) {
+                float c = c0 * (sqrt(n + 1.0) - sqrt(float(n)));
+                ramp[n] = (c > 65535) ? 65535 : u16(c);
+            }
+        }
+
+        boolean add(const i32* steps, u32 rate) {
+            // Queue a move of steps[i] steps on each axis, with the axis
+            // that moves the most going at up to rate steps per second.
+            // Returns false if the queue is full.
+            u8 h = next(head);
+            if(h == tail) {
+                return false;
+            }
+
+            segment& s = queue[head];
+            s.major = 0;
+            s.dirs = 0;
+            for(u8 i = 0; i < axes; i++) {
+                u32 n = (steps[i] < 0) ? -steps[i] : steps[i];
+                s.count[i] = n;
+                if(n > s.major) {
+                    s.major = n;
+                }
+                if(steps[i] > 0) {
+                    s.dirs |= axes_t(1) << i;
+                }
+            }
+            if(s.major == 0) {
+                return true;
+            }
+
+            // v^2 = 2an, so the speed index for rate is rate^2 / 2a
+            u32 n = u32((float(rate) * rate) / (2.0 * acceleration));
+            s.nominal = (n >= ramp_size) ? ramp_size - 1 : n;
+            s.entry = 0;
+            s.exit = 0;
+
+            atomic {
+                s.max_entry = 0;
+                if(head != tail) {
+                    const segment& p = queue[previous(head)];
+                    if(joins(p, s)) {
+                        s.max_entry = (p.nominal < s.nominal) ? p.nominal : s.nominal;
+                    }
+                }
+                head = h;
+                plan();
+            }
+            return true;
+        }
+
+        boolean busy() {
+            return head != tail;
+        }
+
+        u16 tick() {
+            step_out.write(0);
+
+            if(!active) {
+                if(head == tail) {
+                    return idle_interval;
+                }
+                const segment& s = queue[tail];
+                for(u8 i = 0; i < axes; i++) {
+                    error[i] = s.major / 2;
+                }
+                done = 0;
+                if(speed > s.entry) {
+                    speed = s.entry;
+                }
+                active = true;
+                if(s.dirs != dirs) {
+                    dirs = s.dirs;
+                    dir_out.write(dirs);
+                    delay_ns<dir_setup_ns>();
+                }
+            }
+
+            const segment& s = queue[tail];
+
+            // Bresenham: step each axis whose error goes below zero
+            axes_t mask = 0;
+            for(u8 i = 0; i < axes; i++) {
+                error[i] -= s.count[i];
+                if(error[i] < 0) {
+                    error[i] += s.major;
+                    mask |= axes_t(1) << i;
+                }
+            }
+            step_out.write(mask);
+
+            u32 remaining = s.major - ++done;
+            u16 interval = ramp[speed];
+            if(speed > s.exit && remaining <= u32(speed - s.exit)) {
+                speed--;
+            }
+            else if(speed < s.nominal && u32(speed) < s.exit + remaining) {
+                speed++;
+            }
+
+            if(remaining == 0) {
+                active = false;
+                tail = next(tail);
+            }
+            return interval;
+        }
+
+    private:
+        struct segment {
+            u32 count[axes];    // steps for each axis
+            u32 major;          // steps for the axis that moves the most
+            axes_t dirs;        // DIR bits, set for positive moves
+            u16 nominal;        // top speed, as a ramp index
+            u16 max_entry;      // fastest speed at the junction with the previous segment
+            u16 entry;          // planned speeds at the start and end
+            u16 exit;
+        };
+
+        // time from a DIR change to the next STEP pulse
+        static const u32 dir_setup_ns = 200;
+
+        static_assert(axes <= step_port::width && axes <= dir_port::width, "StepperBank needs a STEP and DIR bit for each axis");
+
+        static u8 next(u8 i) {
+            return (i + 1 == queue_size) ? 0 : i + 1;
+        }
+
+        static u8 previous(u8 i) {
+            return (i == 0) ? queue_size - 1 : i - 1;
+        }
+
+        static boolean joins(const segment& a, const segment& b) {
+            // the same axes move, in the same directions
+            for(u8 i = 0; i < axes; i++) {
+                if((a.count[i] == 0) != (b.count[i] == 0)) {
+                    return false;
+                }
+            }
+            return a.dirs == b.dirs;
+        }
+
+        void plan() {
+            // Backward pass: from the last segment (which stops), raise
+            // each segment's entry speed as far as it can still slow down
+            // to its exit speed. The running segment's entry is fixed.
+            u8 last = previous(head);
+            u8 k = last;
+            u32 exit = 0;
+            for(;;) {
+                segment& s = queue[k];
+                s.exit = exit;
+                if(k == tail && active) {
+                    break;
+                }
+                u32 entry = exit + s.major;
+                s.entry = (entry < s.max_entry) ? entry : s.max_entry;
+                if(k == tail) {
+                    break;
+                }
+                exit = s.entry;
+                k = previous(k);
+            }
+
+            // Forward pass: lower each exit speed to what the segment can
+            // reach by accelerating from its entry speed (or, for the
+            // running segment, from its current speed).
+            k = tail;
+            for(;;) {
+                segment& s = queue[k];
+                u32 reach = (k == tail && active) ? speed + (s.major - done) : s.entry + s.major;
+                if(s.exit > reach) {
+                    s.exit = reach;
+                }
+                if(k == last) {
+                    break;
+                }
+                k = next(k);
+                if(queue[k].entry > s.exit) {
+                    queue[k].entry = s.exit;
+                }
+            }
+        }
+
+        step_port step_out;
+        dir_port dir_out;
+
+        u32 acceleration;
+        u16 ramp[ramp_size];
+
+        segment queue[queue_size];
+        volatile u8 head;
+        volatile u8 tail;
+
+        // the running segment
+        volatile boolean active;
+        u32 done;
+        i32 error[axes];
+        u16 speed;
+        axes_t dirs;
+};
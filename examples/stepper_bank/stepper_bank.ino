@@ -0,0 +1,44 @@
+#include <DirectIO.h>
+#include "DirectIO_StepperBank.h"
+
+// Three axes on an Uno with a CNC shield: X, Y and Z STEP on
+// pins 2-4 (port D bits 2-4) and DIR on pins 5-7 (port D bits 5-7).
+// Timer1 counts at 2 MHz, and tick() sets the time to each step.
+// A 512 entry acceleration table allows up to sqrt(2 * 40000 * 512),
+// or about 6400 steps/s.
+StepperBank<OutputPort<PORT_D, 2, 3>, OutputPort<PORT_D, 5, 3>, 3, 8, 512> steppers;
+Output<8> enable(HIGH);    // drivers' enable, active low
+
+const u32 timer_rate = F_CPU / 8;
+
+void setup() {
+  steppers.setup(timer_rate, 40000);   // 40000 steps/s^2
+  enable = LOW;
+
+  // Timer1 in CTC mode, prescaler 8
+  noInterrupts();
+  TCCR1A = 0;
+  TCCR1B = _BV(WGM12) | _BV(CS11);
+  OCR1A = steppers.idle_interval - 1;
+  TIMSK1 = _BV(OCIE1A);
+  interrupts();
+}
+
+ISR(TIMER1_COMPA_vect) {
+  OCR1A = steppers.tick() - 1;
+}
+
+void loop() {
+  // a square in X/Y, with each side split into 4 segments that are
+  // joined without stopping, at up to 6000 steps/s
+  static const i32 sides[4][3] = {
+    { 1000, 0, 0 }, { 0, 1000, 0 }, { -1000, 0, 0 }, { 0, -1000, 0 }
+  };
+  for(u8 side = 0; side < 4; side++) {
+    for(u8 i = 0; i < 4; i++) {
+      while(!steppers.add(sides[side], 6000)) {}
+    }
+  }
+  while(steppers.busy()) {}
+  delay(500);
+}
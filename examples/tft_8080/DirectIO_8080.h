@@ -0,0 +1,191 @@
+/*
+  DirectIO_8080.h - 8080-style parallel display bus using Direct IO library
+  Copyright (c) 2015-2018 Michael Marchetti.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <DirectIO.h>
+
+#if defined(DIRECTIO_FALLBACK)
+#error "Parallel8080Bus requires direct I/O support (AVR, SAM or SAMD boards)"
+#endif
+
+// Bus timing, in nanoseconds. Values are the minimums
+// for the ILI9341 and ST7789 display controllers.
+struct BUS_8080_TIMING {
+    static const u32 t_wrl = 15;    // WR low time
+    static const u32 t_wc = 66;     // write cycle time
+    static const u32 t_rdl = 355;   // RD low time; covers the memory read access time
+    static const u32 t_rc = 450;    // read cycle time
+};
+
+// Selects whether Parallel8080Bus turns the data port around for reads
+struct _bus_write_only {};
+struct _bus_read_write {};
+
+template <u8 rd_pin> struct _bus_mode {
+    typedef _bus_read_write type;
+};
+
+template <> struct _bus_mode<NO_PIN> {
+    typedef _bus_write_only type;
+};
+
+template <class data_port, u8 wr_pin, u8 rd_pin, u8 dc_pin, u8 cs_pin=NO_PIN, class timing=BUS_8080_TIMING>
+class Parallel8080Bus {
+    // The Intel 8080-style parallel interface used by TFT display
+    // controllers, on an 8 or 16 bit data port. Data is latched by the
+    // display on the rising edge of WR; DC selects command (LOW) or
+    // data (HIGH).
+    //
+    // If rd_pin is connected, data_port must be a BiDirectionalPort;
+    // otherwise an OutputPort is enough, and rd_pin is NO_PIN.
+    //
+    // Write cycles are padded to the bus timing at compile time.
+    // fill() sets the data lines once and then only strobes WR, in an
+    // unrolled loop, so on SAM and SAMD51 boards solid fills run close
+    // to the bus's maximum write rate.
+    public:
+        Parallel8080Bus() : wr(HIGH), rd(HIGH), dc(HIGH), cs(HIGH) {
+            make_output(mode_type());
+        }
+
+        void select() {
+            cs = LOW;
+        }
+
+        void deselect() {
+            cs = HIGH;
+        }
+
+        void write_command(u8 value) {
+            dc = LOW;
+            put(value);
+            strobe();
+            dc = HIGH;
+        }
+
+        void write_data(u8 value) {
+            // Write one bus cycle, e.g. a command parameter.
+            put(value);
+            strobe();
+        }
+
+        void write_data(const u16* data, u32 n) {
+            // Write a block of 16 bit values, e.g. RGB565 pixels.
+            // On an 8 bit bus, each is sent high byte first.
+            while(n--) {
+                u16 value = *data++;
+                if(data_port::width < 16) {
+                    put(value >> 8);
+                    strobe();
+                }
+                put(value);
+                strobe();
+            }
+        }
+
+        void fill(u16 value, u32 n) {
+            // Write the same 16 bit value n times.
+            if(data_port::width < 16) {
+                if(u8(value >> 8) != u8(value)) {
+                    // the bytes differ, so the data lines must change
+                    while(n--) {
+                        put(value >> 8);
+                        strobe();
+                        put(value);
+                        strobe();
+                    }
+                    return;
+                }
+                // both bytes are the same: two strobes per value
+                n *= 2;
+            }
+
+            put(value);
+            u32 blocks = n / 8;
+            u8 rest = n % 8;
+            while(blocks--) {
+                strobe();
+                strobe();
+                strobe();
+                strobe();
+                strobe();
+                strobe();
+                strobe();
+                strobe();
+            }
+            while(rest--) {
+                strobe();
+            }
+        }
+
+        port_data_t read_data() {
+            // Read one bus cycle. Requires rd_pin and a BiDirectionalPort.
+            // Note that display controllers return a dummy value on
+            // the first read after a read command.
+            port_data_t value = data.template read_strobed<timing::t_rdl>(rd, LOW);
+            delay_ns<timing::t_rc - timing::t_rdl>();
+            data.make_output();
+            return value;
+        }
+
+    private:
+        typedef typename _bus_mode<rd_pin>::type mode_type;
+
+        void make_output(_bus_write_only) {}
+
+        void make_output(_bus_read_write) {
+            data.make_output();
+        }
+
+        // cycles for each write to WR
+        static const u8 store_cycles = 2;
+
+#if defined(ARDUINO_ARCH_AVR)
+        inline void put(port_data_t value) {
+            data.write(value);
+        }
+#else
+        static inline void put(port_data_t value) {
+            // set and clear the data bits directly, so no
+            // read/modify/write cycle is needed for a partial port
+            typedef typename data_port::port_type port;
+            port_data_t v = value << data_port::first_bit;
+            port::port_output_set(v & data_port::mask);
+            port::port_output_clear(~v & data_port::mask);
+        }
+#endif
+
+        // cycles to wait after each edge of WR, allowing for the store
+        static const u32 wrl_cycles = _ns_to_cycles<timing::t_wrl>::cycles;
+        static const u32 wc_cycles = _ns_to_cycles<timing::t_wc>::cycles;
+        static const u32 low_wait = (wrl_cycles > store_cycles) ? wrl_cycles - store_cycles : 0;
+        static const u32 high_wait = (wc_cycles > wrl_cycles + store_cycles) ? wc_cycles - wrl_cycles - store_cycles : 0;
+
+        inline void strobe() {
+            wr = LOW;
+            delay_cycles<low_wait>();
+            wr = HIGH;
+            delay_cycles<high_wait>();
+        }
+
+        data_port data;
+        Output<wr_pin> wr;
+        Output<rd_pin> rd;
+        Output<dc_pin> dc;
+        Output<cs_pin> cs;
+};
@@ -0,0 +1,57 @@
+#include <DirectIO.h>
+#include "DirectIO_8080.h"
+
+// An ILI9341 display with an 8 bit parallel interface. The data bus is
+// on port D (pins 0-7 on an Uno), with WR on A1, RD on A0,
+// DC on A2 and CS on A3.
+Parallel8080Bus<BiDirectionalPort<PORT_D>, A1, A0, A2, A3> bus;
+
+const u16 width = 240;
+const u16 height = 320;
+
+void set_window(u16 x0, u16 y0, u16 x1, u16 y1) {
+  // column and page address set, then start a memory write
+  bus.write_command(0x2A);
+  bus.write_data(u8(x0 >> 8));
+  bus.write_data(u8(x0));
+  bus.write_data(u8(x1 >> 8));
+  bus.write_data(u8(x1));
+  bus.write_command(0x2B);
+  bus.write_data(u8(y0 >> 8));
+  bus.write_data(u8(y0));
+  bus.write_data(u8(y1 >> 8));
+  bus.write_data(u8(y1));
+  bus.write_command(0x2C);
+}
+
+void setup() {
+  bus.select();
+  bus.write_command(0x01);    // software reset
+  delay(150);
+  bus.write_command(0x11);    // sleep out
+  delay(120);
+  bus.write_command(0x3A);    // 16 bits per pixel
+  bus.write_data(u8(0x55));
+  bus.write_command(0x29);    // display on
+}
+
+void loop() {
+  // solid fills only strobe WR; the data lines don't change
+  static const u16 colors[] = { 0x0000, 0xF800, 0x07E0, 0x001F, 0xFFFF };
+  for(u8 i = 0; i < 5; i++) {
+    set_window(0, 0, width - 1, height - 1);
+    bus.fill(colors[i], u32(width) * height);
+    delay(500);
+  }
+
+  // a small gradient, sent as a burst
+  u16 line[width];
+  for(u16 x = 0; x < width; x++) {
+    line[x] = (x >> 3) << 11;
+  }
+  set_window(0, 0, width - 1, 15);
+  for(u8 y = 0; y < 16; y++) {
+    bus.write_data(line, width);
+  }
+  delay(500);
+}
@@ -0,0 +1,188 @@
+/*
+  DirectIO_Touch.h - Parallel capacitive touch sensing using Direct IO library
+  Copyright (c) 2015-2018 Michael Marchetti.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <DirectIO.h>
+
+#if defined(DIRECTIO_FALLBACK)
+#error "TouchPort requires direct I/O support (AVR, SAM or SAMD boards)"
+#endif
+
+template <class sense_port, class send_port, u8 samples=4, u16 timeout=2000>
+class TouchPort {
+    // Capacitive touch sensing on every bit of sense_port at once.
+    // Each pad is wired to a sense pin, and through a high value
+    // resistor (around 1 Mohm) to a send pin: one per pad, or a single
+    // send pin shared by all of them.
+    //
+    // A measurement drives all pads LOW to discharge them, then releases
+    // them and drives the send pins HIGH. The port is then read in a
+    // tight loop, counting iterations, and each pad's count is taken
+    // when its bit first reads HIGH. A finger on a pad adds capacitance,
+    // so it takes longer to charge. Each update() adds up samples
+    // measurements, with interrupts disabled during each one; a pad
+    // that hasn't charged after timeout iterations counts as timeout.
+    //
+    // Each pad has a baseline, which slowly follows its count while it
+    // isn't touched. A pad is touched when its count is more than
+    // touch_threshold above the baseline, and released when it falls
+    // below release_threshold (the gap is the hysteresis).
+    public:
+        static const u8 pads = sense_port::width;
+        typedef bits_type(pads) pads_t;
+
+        TouchPort() : touch_threshold(40), release_threshold(25), state(0) {
+            for(u8 i = 0; i < pads; i++) {
+                counts[i] = 0;
+                baseline[i] = 0;
+            }
+        }
+
+        void setup() {
+            // Take the current counts as the baselines; no pads
+            // should be touched while this runs.
+            sense_in.setup();
+            send_out.setup();
+            measure();
+            for(u8 i = 0; i < pads; i++) {
+                baseline[i] = u32(counts[i]) << baseline_shift;
+            }
+            state = 0;
+        }
+
+        void set_thresholds(u16 touch, u16 release) {
+            // counts above the baseline to touch and to release a pad
+            touch_threshold = touch;
+            release_threshold = release;
+        }
+
+        pads_t update() {
+            // Measure all pads, and return the pads now touched.
+            measure();
+            pads_t bit = 1;
+            for(u8 i = 0; i < pads; i++, bit <<= 1) {
+                i32 d = delta(i);
+                if(state & bit) {
+                    if(d < i32(release_threshold)) {
+                        state &= ~bit;
+                    }
+                }
+                else if(d > i32(touch_threshold)) {
+                    state |= bit;
+                }
+                else {
+                    // not touched: move the baseline 1/16 of the way
+                    // towards the count
+                    i32 target = i32(counts[i]) << baseline_shift;
+                    baseline[i] += (target - i32(baseline[i])) >> baseline_rate;
+                }
+            }
+            return state;
+        }
+
+        pads_t touched() {
+            return state;
+        }
+
+        u16 read(u8 pad) {
+            // the pad's count from the last update
+            return counts[pad];
+        }
+
+        i32 delta(u8 pad) {
+            // the pad's count less its baseline
+            return i32(counts[pad]) - i32(baseline[pad] >> baseline_shift);
+        }
+
+    private:
+        typedef typename sense_port::port_type port;
+        typedef typename send_port::port_type send;
+        static const pads_t all_pads = pads_t((2ULL << (pads - 1)) - 1);
+
+        // baselines are kept with 4 fractional bits,
+        // and move 1/16 of the way to each count
+        static const u8 baseline_shift = 4;
+        static const u8 baseline_rate = 4;
+
+        // time for the pads to discharge
+        static const u32 discharge_us = 10;
+
+        void measure() {
+            for(u8 i = 0; i < pads; i++) {
+                counts[i] = 0;
+            }
+            for(u8 n = 0; n < samples; n++) {
+                // discharge the pads
+                atomic {
+                    send::port_output_clear(send_port::mask);
+                    port::port_output_clear(sense_port::mask);
+                    port::port_make_outputs(sense_port::mask);
+                }
+                delay_us<discharge_us>();
+
+                // The timed loop only latches when pads charge (at most
+                // pads times), so every iteration takes about the same
+                // time; the counts are added up after it.
+                pads_t charged[pads];
+                u16 times[pads];
+                u8 events = 0;
+                pads_t pending = all_pads;
+                atomic {
+                    // the port registers are written directly: a partial
+                    // OutputPort's write() has its own atomic block, which
+                    // would re-enable interrupts on ARM
+                    port::port_make_inputs(sense_port::mask);
+                    send::port_output_set(send_port::mask);
+
+                    u16 t = 0;
+                    do {
+                        pads_t high = pads_t(sense_in.read()) & pending;
+                        if(high) {
+                            pending &= ~high;
+                            charged[events] = high;
+                            times[events++] = t;
+                        }
+                    } while(pending && ++t < timeout);
+                }
+                for(u8 e = 0; e < events; e++) {
+                    record(charged[e], times[e]);
+                }
+                record(pending, timeout);
+            }
+            send_out.write(0);
+        }
+
+        void record(pads_t high, u16 t) {
+            pads_t bit = 1;
+            for(u8 i = 0; i < pads; i++, bit <<= 1) {
+                if(high & bit) {
+                    counts[i] += t;
+                }
+            }
+        }
+
+        static_assert(send_port::width == 1 || send_port::width == pads, "send_port needs one pin, or one per pad");
+
+        sense_port sense_in;
+        send_port send_out;
+        u16 touch_threshold;
+        u16 release_threshold;
+        pads_t state;
+        u16 counts[pads];
+        u32 baseline[pads];
+};
@@ -0,0 +1,22 @@
+#include <DirectIO.h>
+#include "DirectIO_Touch.h"
+
+// Six touch pads on port D bits 2-7 (pins 2-7 on an Uno), each
+// connected through a 1 Mohm resistor to pin 8 (port B bit 0).
+TouchPort<InputPort<PORT_D, 2, 6>, OutputPort<PORT_B, 0, 1> > pads;
+
+void setup() {
+  Serial.begin(115200);
+  pads.setup();
+}
+
+void loop() {
+  u8 touched = pads.update();
+  for(u8 i = 0; i < pads.pads; i++) {
+    Serial.print(pads.delta(i));
+    Serial.print(' ');
+  }
+  Serial.print(" touched: ");
+  Serial.println(touched, BIN);
+  delay(50);
+}
@@ -0,0 +1,261 @@
+/*
+  DirectIO_Video.h - VGA video signal generator using Direct IO library
+  Copyright (c) 2015-2018 Michael Marchetti.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <DirectIO.h>
+
+#if defined(DIRECTIO_FALLBACK)
+#error "VideoOut requires direct I/O support (AVR, SAM or SAMD boards)"
+#endif
+
+// VGA 640x480 at 60 Hz. Times are in nanoseconds; both syncs are active low.
+struct VGA_640x480 {
+    static const u32 line = 31778;
+    static const u32 hsync = 3813;
+    static const u32 back_porch = 1907;
+    static const u32 visible = 25422;
+    static const u16 lines = 525;
+    static const u16 visible_lines = 480;
+    static const u16 vsync_start = 490;
+    static const u16 vsync_lines = 2;
+};
+
+// Unrolls a line of n pixels by binary recursion (ARM),
+// so the generated code is straight-line loads and stores.
+template <class video_t, u16 n>
+struct _video_unroll {
+    static inline void run(const u8*& p, port_data_t other) {
+        _video_unroll<video_t, n / 2>::run(p, other);
+        _video_unroll<video_t, n - n / 2>::run(p, other);
+    }
+};
+
+template <class video_t>
+struct _video_unroll<video_t, 1> {
+    static inline void run(const u8*& p, port_data_t other) {
+        video_t::pixel(p, other);
+    }
+};
+
+template <class pixel_port, u8 hsync_pin, u8 vsync_pin, u16 width, u16 height, class timing=VGA_640x480>
+class VideoOut {
+    // Generates a VGA signal from a frame buffer of width x height pixels.
+    // Each pixel is a byte written to 8 bits of pixel_port, typically
+    // driving a resistor DAC (e.g. 3 bits red, 3 green, 2 blue).
+    // Each frame buffer row is repeated to fill the visible lines.
+    //
+    // Call scanline() from a timer interrupt running every line_cycles
+    // CPU cycles. The hsync pulse, porch and pixel stores are all
+    // placed by compile-time cycle counts. The pixels don't fill the
+    // whole visible line: reserve_cycles of it are left for interrupt
+    // entry and exit, the line bookkeeping and the main program, and
+    // the rest is divided evenly between the pixels, so the image
+    // covers width * pixel_cycles of the visible_cycles: with 40
+    // columns at 16 MHz, 200 of 407 cycles, about the left half of the
+    // screen. On the Due (84 MHz), a line can hold up to about 390
+    // pixels, e.g. 320 x 240.
+    //
+    // Interrupt latency shows up as horizontal jitter. On AVR, pass the
+    // number of cycles the interrupt was late (0-7, e.g. from the
+    // timer count) as lag and scanline() will even it out; sleeping
+    // between interrupts also gives a constant latency. Draw into the
+    // frame buffer while vblank() is true to avoid tearing.
+    public:
+        static const u32 line_cycles = u32(((unsigned long long)(timing::line) * F_CPU + 500000000ULL) / 1000000000ULL);
+
+        // pixel values, one byte per pixel
+        u8 frame[height][width];
+
+        VideoOut() : line(0), row(0), repeat(0), next(frame[0]), hsync(HIGH), vsync(HIGH) {
+            for(u16 y = 0; y < height; y++) {
+                for(u16 x = 0; x < width; x++) {
+                    frame[y][x] = 0;
+                }
+            }
+        }
+
+        boolean vblank() {
+            u16 n;
+            atomic {
+                n = line;
+            }
+            return n >= timing::visible_lines;
+        }
+
+        void scanline(u8 lag=0) {
+            const u8* p = next;
+
+#if defined(ARDUINO_ARCH_AVR)
+            align(lag);
+#endif
+            hsync = LOW;
+            delay_cycles<hsync_cycles - sync_store_cycles>();
+            hsync = HIGH;
+            delay_cycles<back_porch_cycles - sync_store_cycles>();
+            if(p) {
+                pixels(p);
+            }
+
+            // set up the next line
+            if(++line == timing::lines) {
+                line = 0;
+                row = 0;
+                repeat = 0;
+            }
+            if(line == timing::vsync_start) {
+                vsync = LOW;
+            }
+            else if(line == timing::vsync_start + timing::vsync_lines) {
+                vsync = HIGH;
+            }
+            if(line < timing::visible_lines) {
+                next = frame[row];
+                if(++repeat == line_repeat) {
+                    repeat = 0;
+                    row++;
+                }
+            }
+            else {
+                next = 0;
+            }
+        }
+
+    private:
+        typedef typename pixel_port::port_type port;
+        static const port_data_t mask = port_data_t(0xFF) << pixel_port::first_bit;
+
+        static const u32 hsync_cycles = _ns_to_cycles<timing::hsync>::cycles;
+        static const u32 back_porch_cycles = _ns_to_cycles<timing::back_porch>::cycles;
+        static const u32 visible_cycles = _ns_to_cycles<timing::visible>::cycles;
+        static const u16 line_repeat = timing::visible_lines / height;
+
+#if defined(ARDUINO_ARCH_AVR)
+        // each pixel is a load and a store; the hsync pin is set with
+        // sbi/cbi, or a read-modify-write with interrupts off above 0x40
+        static const u8 store_cycles = (port::out < 0x60) ? 1 : 2;
+        static const u8 pixel_overhead = 2 + store_cycles;
+        static const u8 sync_store_cycles = (_pins<hsync_pin>::out < 0x40) ? 2 : 8;
+
+        // interrupt entry and exit (about 90 cycles, saving registers),
+        // the bookkeeping after the pixels, and time for loop()
+        static const u32 reserve_cycles = 200;
+#else
+        // estimated cycles for each store, and for each pixel's load,
+        // shift and store (the line is unrolled, so there is no loop).
+        // SAMD also merges in the rest of the port; on SAM, the output
+        // write mask lets the store leave the other bits alone.
+        static const u8 store_cycles = 2;
+#if defined(ARDUINO_ARCH_SAM)
+        static const u8 pixel_overhead = 5;
+#else
+        static const u8 pixel_overhead = 6;
+#endif
+        static const u8 sync_store_cycles = 2;
+        static const u32 reserve_cycles = 150;
+#endif
+        static const u32 pixel_cycles = (visible_cycles - reserve_cycles) / width;
+        static const u32 pad = pixel_cycles - pixel_overhead;
+
+        static_assert(visible_cycles > reserve_cycles && pixel_cycles >= pixel_overhead,
+                      "width is too large for this CPU clock");
+
+        static_assert(timing::visible_lines % height == 0, "height must divide the number of visible lines");
+
+#if defined(ARDUINO_ARCH_AVR)
+        static_assert(pixel_port::width == 8, "VideoOut needs a full 8 bit port on AVR");
+
+        static inline void align(u8 lag) {
+            // Wait 7 - lag cycles: each bit of lag that is clear
+            // adds 1, 2 or 4 cycles (sbrs skips lpm/rjmp when set).
+            __asm__ __volatile__ (
+                "   sbrs %[lag], 0 \n"
+                "   rjmp .+0       \n"
+                "   sbrs %[lag], 1 \n"
+                "   lpm            \n"
+                "   sbrs %[lag], 2 \n"
+                "   lpm            \n"
+                "   sbrs %[lag], 2 \n"
+                "   lpm            \n"
+                :
+                : [lag] "r" (lag)
+                : "r0"
+            );
+        }
+
+        static inline void pixels(const u8* p) {
+            // fully unrolled: one load and one store per pixel,
+            // then black for the porch
+            __asm__ __volatile__ (
+                ".rept %[w]                              \n"
+                "   ld __tmp_reg__, %a[p]+               \n"
+                "   .if %[addr] < 0x60                   \n"
+                "       out %[addr] - 0x20, __tmp_reg__  \n"
+                "   .else                                \n"
+                "       sts %[addr], __tmp_reg__         \n"
+                "   .endif                               \n"
+                "   .rept %[pad]                         \n"
+                "       nop                              \n"
+                "   .endr                                \n"
+                ".endr                                   \n"
+                "   clr __tmp_reg__                      \n"
+                ".if %[addr] < 0x60                      \n"
+                "   out %[addr] - 0x20, __tmp_reg__      \n"
+                ".else                                   \n"
+                "   sts %[addr], __tmp_reg__             \n"
+                ".endif                                  \n"
+                : [p] "+e" (p)
+                : [addr] "n" (port::out), [w] "n" (width), [pad] "n" (pad)
+            );
+        }
+#else
+        friend struct _video_unroll<VideoOut, 1>;
+
+        static inline void pixel(const u8*& p, port_data_t other) {
+            port::port_output_write(other | (port_data_t(*p++) << pixel_port::first_bit));
+            delay_cycles<pad>();
+        }
+
+#if defined(ARDUINO_ARCH_SAM)
+        static inline void pixels(const u8* p) {
+            // Only let PIO_ODSR stores change the pixel bits, then put
+            // the write mask back to all bits, as the Due core sets it.
+            Pio* pio = (Pio*)port::pio;
+            pio->PIO_OWDR = 0xFFFFFFFF & ~mask;
+            _video_unroll<VideoOut, width>::run(p, 0);
+            port::port_output_write(0);
+            pio->PIO_OWER = 0xFFFFFFFF & ~mask;
+        }
+#else
+        static inline void pixels(const u8* p) {
+            // the other bits of the port are kept as they are
+            port_data_t other = port::port_output_read() & ~mask;
+            _video_unroll<VideoOut, width>::run(p, other);
+            port::port_output_write(other);
+        }
+#endif
+#endif
+
+        volatile u16 line;
+        u16 row;
+        u16 repeat;
+        const u8* next;
+
+        pixel_port pixel_out;
+        Output<hsync_pin> hsync;
+        Output<vsync_pin> vsync;
+};
@@ -0,0 +1,58 @@
+#include <DirectIO.h>
+#include <avr/sleep.h>
+#include "DirectIO_Video.h"
+
+// VGA output from an Uno: an 8 bit resistor DAC (3 bits red,
+// 3 green, 2 blue) on port D (pins 0-7), HSYNC on pin 9 and
+// VSYNC on pin 10. The frame buffer is 40 x 30 color cells.
+typedef VideoOut<OutputPort<PORT_D>, 9, 10, 40, 30> Video;
+Video video;
+
+u8 x = 0;
+u8 y = 0;
+
+void setup() {
+  // draw color bars
+  for(u8 row = 0; row < 30; row++) {
+    for(u8 col = 0; col < 40; col++) {
+      video.frame[row][col] = col * 6;
+    }
+  }
+
+  // Timer0 (millis) would add jitter, so turn it off.
+  // Timer1 in CTC mode interrupts at the start of each line.
+  noInterrupts();
+  TIMSK0 = 0;
+  TCCR1A = 0;
+  TCCR1B = _BV(WGM12) | _BV(CS10);
+  OCR1A = Video::line_cycles - 1;
+  TIMSK1 = _BV(OCIE1A);
+  interrupts();
+  set_sleep_mode(SLEEP_MODE_IDLE);
+}
+
+ISR(TIMER1_COMPA_vect) {
+  video.scanline();
+}
+
+void loop() {
+  // Move a white cell across the screen once per frame. Drawing only
+  // happens in vertical blanking; otherwise the CPU sleeps, so each
+  // line interrupt starts with the same latency.
+  static boolean drawn = false;
+  if(video.vblank()) {
+    if(!drawn) {
+      video.frame[y][x] = x * 6;
+      if(++x == 40) {
+        x = 0;
+        y = (y + 1) % 30;
+      }
+      video.frame[y][x] = 0xFF;
+      drawn = true;
+    }
+  }
+  else {
+    drawn = false;
+  }
+  sleep_mode();
+}
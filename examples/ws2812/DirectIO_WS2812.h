@@ -0,0 +1,364 @@
+/*
+  DirectIO_WS2812.h - WS2812 (NeoPixel) LED driver using Direct IO library
+  Copyright (c) 2015-2018 Michael Marchetti.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include <DirectIO.h>
+
+#if defined(DIRECTIO_FALLBACK)
+#error "WS2812 requires direct I/O support (AVR, SAM or SAMD boards)"
+#endif
+
+// WS2812 bit timing, in nanoseconds. Each bit starts with a high pulse;
+// a short pulse is a 0 and a long pulse is a 1. The LEDs latch their
+// data when the line stays low for latch_us microseconds.
+struct WS2812_TIMING {
+    static const u32 t0h = 300;         // high time of a 0 bit
+    static const u32 t1h = 700;         // high time of a 1 bit
+    static const u32 period = 1250;     // bit period
+    static const u32 latch_us = 300;
+};
+
+template <u8 pin, u8 channels=3, class timing=WS2812_TIMING>
+class WS2812 {
+    // Sends pixel data to a chain of WS2812 (or compatible) LEDs.
+    // Data is sent in the order stored in the buffer, which for WS2812
+    // is green, red, blue; use channels=4 for RGBW parts like the SK6812.
+    //
+    // Each byte is sent with interrupts disabled, and every edge within
+    // it is placed at a cycle count computed at compile time from F_CPU.
+    // Interrupts may run between bytes; this lengthens a low period,
+    // which the LEDs tolerate as long as it is shorter than the latch time.
+    //
+    // On AVR, each bit is a single instruction sequence with one port
+    // store per edge (8 MHz and up). On SAM and SAMD51 boards, edges
+    // are timed against the DWT cycle counter. SAMD21 boards have no
+    // cycle counter, so their bit times are open loop.
+    public:
+        WS2812() : out(LOW), last(0) {}
+
+        void show(const u8* data, u16 pixels, u8 brightness=255) {
+            // Send pixels * channels bytes, scaling each by brightness/255.
+            // Waits for the previous frame to latch before starting.
+            u16 scale = u16(brightness) + 1;
+            u16 n = pixels * channels;
+
+            while(micros() - last < timing::latch_us) {}
+#if defined(DIRECTIO_CYCLE_COUNTER)
+            cycle_counter_setup();
+#endif
+            for(u16 i = 0; i < n; i++) {
+                u8 value = u8((u16(data[i]) * scale) >> 8);
+                atomic {
+                    send(value);
+                }
+            }
+            last = micros();
+        }
+
+    private:
+        static const u32 t0h = _ns_to_cycles<timing::t0h>::cycles;
+        static const u32 t1h = _ns_to_cycles<timing::t1h>::cycles;
+        static const u32 period = _ns_to_cycles<timing::period>::cycles;
+
+#if defined(ARDUINO_ARCH_AVR)
+        // Cycles per bit, with store_cycles (s) per port store:
+        //   0 bit high time = s + a + 1
+        //   1 bit high time = 2s + a + b + 1
+        //   bit period      = 3s + a + b + c + 5
+        // At 8 MHz the fixed instructions take 11 cycles,
+        // stretching the period to 1.375us, which is within tolerance.
+        static const u8 s = (_pins<pin>::out < 0x60) ? 1 : 2;
+        static const u8 a = (t0h > s + 1) ? t0h - (s + 1) : 0;
+        static const u8 b = (t1h > 2 * s + a + 1) ? t1h - (2 * s + a + 1) : 0;
+        static const u8 c = (period > 3 * s + a + b + 5) ? period - (3 * s + a + b + 5) : 0;
+
+        static_assert(F_CPU >= 8000000UL, "WS2812 requires a CPU clock of at least 8 MHz");
+
+        static inline void send(u8 value) {
+            const u8 mask = 1 << _pins<pin>::bit;
+            u8 hi = *port_t(_pins<pin>::out) | mask;
+            u8 lo = hi & ~mask;
+            u8 count = 8;
+
+            // sbrs takes 2 cycles when it skips the store, and 1 when it
+            // doesn't, so both paths through a bit take the same time.
+            __asm__ __volatile__ (
+                "1:                          \n"
+                ".if %[addr] < 0x60          \n"
+                "   out %[addr] - 0x20, %[hi] \n"
+                ".else                       \n"
+                "   sts %[addr], %[hi]        \n"
+                ".endif                      \n"
+                ".rept %[a]                  \n"
+                "   nop                      \n"
+                ".endr                       \n"
+                "   sbrs %[value], 7         \n"
+                ".if %[addr] < 0x60          \n"
+                "   out %[addr] - 0x20, %[lo] \n"
+                ".else                       \n"
+                "   sts %[addr], %[lo]        \n"
+                ".endif                      \n"
+                ".rept %[b]                  \n"
+                "   nop                      \n"
+                ".endr                       \n"
+                ".if %[addr] < 0x60          \n"
+                "   out %[addr] - 0x20, %[lo] \n"
+                ".else                       \n"
+                "   sts %[addr], %[lo]        \n"
+                ".endif                      \n"
+                "   lsl %[value]             \n"
+                ".rept %[c]                  \n"
+                "   nop                      \n"
+                ".endr                       \n"
+                "   dec %[count]             \n"
+                "   brne 1b                  \n"
+                : [value] "+r" (value), [count] "+r" (count)
+                : [hi] "r" (hi), [lo] "r" (lo), [addr] "n" (_pins<pin>::out),
+                  [a] "n" (a), [b] "n" (b), [c] "n" (c)
+            );
+        }
+
+#elif defined(DIRECTIO_CYCLE_COUNTER)
+        static inline void send(u8 value) {
+            u32 start = cycle_count();
+            u32 t = 0;
+
+            for(u8 bit = 0x80; bit; bit >>= 1) {
+                wait_cycles(start, t);
+                _pins<pin>::port_output_set(_pins<pin>::mask);
+                wait_cycles(start, t + ((value & bit) ? t1h : t0h));
+                _pins<pin>::port_output_clear(_pins<pin>::mask);
+                t += period;
+            }
+            wait_cycles(start, t);
+        }
+
+#else
+        // Cortex-M0+: estimated cycles for each port store,
+        // and for the loop and bit test.
+        static const u8 store_cycles = 2;
+        static const u8 loop_cycles = 6;
+
+        static inline void send(u8 value) {
+            const port_data_t mask = _pins<pin>::mask;
+
+            for(u8 i = 0; i < 8; i++) {
+                // clearing no bits is a no-op, so a 1 bit
+                // leaves the line high until the second clear.
+                port_data_t early = (value & 0x80) ? 0 : mask;
+                _pins<pin>::port_output_set(mask);
+                delay_cycles<t0h - store_cycles>();
+                _pins<pin>::port_output_clear(early);
+                delay_cycles<t1h - t0h - store_cycles>();
+                _pins<pin>::port_output_clear(mask);
+                value <<= 1;
+                delay_cycles<period - t1h - store_cycles - loop_cycles>();
+            }
+        }
+#endif
+
+        Output<pin> out;
+        u32 last;
+};
+
+template <class output_port, u16 pixels, u8 channels=3, class timing=WS2812_TIMING>
+class ParallelWS2812 {
+    // Drives one WS2812 strip from each bit of an OutputPort, all in
+    // lockstep: every bit slot is one store raising all the lines, one
+    // dropping the lines that send a 0, and one dropping the rest. A full
+    // port drives 8 strips on AVR, or up to 32 on SAM and SAMD boards,
+    // in the time it takes to send one.
+    //
+    // Pixel data is kept bit-transposed: each frame buffer entry holds
+    // one bit of one byte for every strip, already in port bit positions,
+    // so show() streams it with no per-bit work. set() and load() do the
+    // transposition ahead of time.
+    //
+    // Each byte is sent with interrupts disabled, as for WS2812.
+    // AVR boards need a 16 MHz or faster clock.
+    public:
+        static const u8 lanes = output_port::width;
+        static const u16 bytes = pixels * channels;
+
+        ParallelWS2812() : last(0) {
+            clear();
+        }
+
+        void setup() {
+            // make the lanes outputs; call this before the first show()
+            lines.setup();
+        }
+
+        void clear() {
+            for(u16 i = 0; i < bytes * 8; i++) {
+                planes[i] = 0;
+            }
+        }
+
+        void set(u8 lane, u16 index, u8 value) {
+            // Set byte index (pixel * channels + channel) of one strip.
+            const port_data_t bit = port_data_t(1) << (output_port::first_bit + lane);
+            port_data_t* p = &planes[index * 8];
+
+            for(u8 mask = 0x80; mask; mask >>= 1) {
+                if(value & mask) {
+                    *p |= bit;
+                }
+                else {
+                    *p &= ~bit;
+                }
+                p++;
+            }
+        }
+
+        void load(u8 lane, const u8* data, u8 brightness=255) {
+            // Copy a whole strip of pixels * channels bytes into
+            // the frame buffer, scaling each by brightness/255.
+            u16 scale = u16(brightness) + 1;
+            for(u16 i = 0; i < bytes; i++) {
+                set(lane, i, u8((u16(data[i]) * scale) >> 8));
+            }
+        }
+
+        void show() {
+            // Send the frame buffer to all strips.
+            // Waits for the previous frame to latch before starting.
+            const port_data_t* p = planes;
+
+            while(micros() - last < timing::latch_us) {}
+#if defined(DIRECTIO_CYCLE_COUNTER)
+            cycle_counter_setup();
+#endif
+            for(u16 i = 0; i < bytes; i++) {
+                atomic {
+                    send(p);
+                }
+                p += 8;
+            }
+            last = micros();
+        }
+
+    private:
+        typedef typename output_port::port_type port;
+        static const port_data_t mask = output_port::mask;
+
+        static const u32 t0h = _ns_to_cycles<timing::t0h>::cycles;
+        static const u32 t1h = _ns_to_cycles<timing::t1h>::cycles;
+        static const u32 period = _ns_to_cycles<timing::period>::cycles;
+
+#if defined(ARDUINO_ARCH_AVR)
+        // Cycles per bit, with store_cycles (s) per port store:
+        //   0 bit high time = s + a
+        //   1 bit high time = 2s + a + b
+        //   bit period      = 3s + a + b + c + 6
+        static const u8 s = (port::out < 0x60) ? 1 : 2;
+        static const u8 a = (t0h > s) ? t0h - s : 0;
+        static const u8 b = (t1h > 2 * s + a) ? t1h - (2 * s + a) : 0;
+        static const u8 c = (period > 3 * s + a + b + 6) ? period - (3 * s + a + b + 6) : 0;
+
+        static_assert(F_CPU >= 16000000UL, "ParallelWS2812 requires a CPU clock of at least 16 MHz");
+
+        static inline void send(const u8* p) {
+            u8 latch = *port_t(port::out);
+            u8 hi = latch | mask;
+            u8 lo = latch & ~mask;
+            u8 v = *p++ | lo;
+            u8 count = 8;
+
+            // The next slot is loaded during the low part of each bit.
+            // The last load reads the entry after this byte; the frame
+            // buffer has a spare entry at the end for this.
+            __asm__ __volatile__ (
+                "1:                          \n"
+                ".if %[addr] < 0x60          \n"
+                "   out %[addr] - 0x20, %[hi] \n"
+                ".else                       \n"
+                "   sts %[addr], %[hi]        \n"
+                ".endif                      \n"
+                ".rept %[a]                  \n"
+                "   nop                      \n"
+                ".endr                       \n"
+                ".if %[addr] < 0x60          \n"
+                "   out %[addr] - 0x20, %[v]  \n"
+                ".else                       \n"
+                "   sts %[addr], %[v]         \n"
+                ".endif                      \n"
+                ".rept %[b]                  \n"
+                "   nop                      \n"
+                ".endr                       \n"
+                ".if %[addr] < 0x60          \n"
+                "   out %[addr] - 0x20, %[lo] \n"
+                ".else                       \n"
+                "   sts %[addr], %[lo]        \n"
+                ".endif                      \n"
+                "   ld %[v], %a[p]+          \n"
+                "   or %[v], %[lo]           \n"
+                ".rept %[c]                  \n"
+                "   nop                      \n"
+                ".endr                       \n"
+                "   dec %[count]             \n"
+                "   brne 1b                  \n"
+                : [v] "+r" (v), [p] "+e" (p), [count] "+r" (count)
+                : [hi] "r" (hi), [lo] "r" (lo), [addr] "n" (port::out),
+                  [a] "n" (a), [b] "n" (b), [c] "n" (c)
+            );
+        }
+
+#elif defined(DIRECTIO_CYCLE_COUNTER)
+        static inline void send(const port_data_t* p) {
+            u32 start = cycle_count();
+            u32 t = 0;
+
+            for(u8 i = 0; i < 8; i++) {
+                port_data_t zeros = ~p[i] & mask;
+                wait_cycles(start, t);
+                port::port_output_set(mask);
+                wait_cycles(start, t + t0h);
+                port::port_output_clear(zeros);
+                wait_cycles(start, t + t1h);
+                port::port_output_clear(mask);
+                t += period;
+            }
+            wait_cycles(start, t);
+        }
+
+#else
+        // Cortex-M0+: estimated cycles for each port store,
+        // and for the loop and buffer load.
+        static const u8 store_cycles = 2;
+        static const u8 loop_cycles = 6;
+
+        static inline void send(const port_data_t* p) {
+            for(u8 i = 0; i < 8; i++) {
+                port_data_t zeros = ~p[i] & mask;
+                port::port_output_set(mask);
+                delay_cycles<t0h - store_cycles>();
+                port::port_output_clear(zeros);
+                delay_cycles<t1h - t0h - store_cycles>();
+                port::port_output_clear(mask);
+                delay_cycles<period - t1h - store_cycles - loop_cycles>();
+            }
+        }
+#endif
+
+        // one entry per bit of each byte, plus a spare (see send)
+        port_data_t planes[bytes * 8 + 1];
+        u32 last;
+
+        output_port lines;
+};
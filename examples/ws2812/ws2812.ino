@@ -0,0 +1,37 @@
+#include <DirectIO.h>
+#include "DirectIO_WS2812.h"
+
+// A strip of 60 WS2812 LEDs with its data input on pin 6.
+const u16 pixels = 60;
+WS2812<6> strip;
+
+// Four more strips of 20 LEDs on port B bits 0-3 (pins 8-11 on an Uno),
+// all sent at once.
+const u16 parallel_pixels = 20;
+ParallelWS2812<OutputPort<PORT_B, 0, 4>, parallel_pixels> strips;
+
+// green, red, blue for each pixel
+u8 grb[pixels * 3];
+
+void setup() {
+  strips.setup();
+}
+
+void loop() {
+  // a red dot moving along the strip, at quarter brightness
+  for(u16 p = 0; p < pixels; p++) {
+    memset(grb, 0, sizeof(grb));
+    grb[p * 3 + 1] = 255;
+    strip.show(grb, pixels, 64);
+
+    // the same dot on each of the parallel strips, in a different
+    // color per strip, staggered by 5 pixels
+    strips.clear();
+    for(u8 lane = 0; lane < strips.lanes; lane++) {
+      u16 q = (p + lane * 5) % parallel_pixels;
+      strips.set(lane, q * 3 + lane % 3, 64);
+    }
+    strips.show();
+    delay(20);
+  }
+}
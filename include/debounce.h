@@ -0,0 +1,139 @@
+/*
+  debounce.h - Parallel input debouncing for Direct IO library
+  Copyright (c) 2015-2018 Michael Marchetti.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _DIRECTIO_DEBOUNCE_H
+#define _DIRECTIO_DEBOUNCE_H 1
+
+template <class bits_t, u8 samples>
+class VerticalCounter {
+    // A counter for each bit of bits_t, of the ticks that bit has
+    // differed from its debounced state. The counters are stored
+    // "vertically": plane i holds bit i of every counter, so all of
+    // them are counted and compared with a few logical operations
+    // per plane.
+    public:
+        VerticalCounter() {
+            for(u8 i = 0; i < planes; i++) {
+                count[i] = 0;
+            }
+        }
+
+        bits_t tick(bits_t delta) {
+            // Count up the bits set in delta and reset the others.
+            // Returns the bits that have now been set for samples
+            // ticks in a row; their counters are reset.
+
+            // bits whose count is already samples - 1 change now
+            bits_t change = delta;
+            for(u8 i = 0; i < planes; i++) {
+                change &= ((samples - 1) & (1 << i)) ? count[i] : bits_t(~count[i]);
+            }
+
+            bits_t carry = delta;
+            bits_t keep = delta & ~change;
+            for(u8 i = 0; i < planes; i++) {
+                bits_t c = count[i] & carry;
+                count[i] = (count[i] ^ carry) & keep;
+                carry = c;
+            }
+            return change;
+        }
+
+    private:
+        static const u8 planes = (samples > 16) ? 5 : (samples > 8) ? 4 : (samples > 4) ? 3 : (samples > 2) ? 2 : 1;
+
+        static_assert(samples >= 2 && samples <= 32, "samples must be from 2 to 32");
+
+        bits_t count[planes];
+};
+
+template <class input, u8 samples=4, boolean active=HIGH>
+class DebouncedPort {
+    // Debounces every bit of an InputPort or InputGroup at once.
+    // A bit changes state once it has read the other way for samples
+    // ticks in a row. Call tick() at a fixed rate, typically from a
+    // 1 kHz timer interrupt. The bits are counted in parallel by a
+    // VerticalCounter.
+    //
+    // With active=LOW (e.g. buttons to ground with pullups), a bit is
+    // set in read() and pressed() when its input is LOW.
+    public:
+        typedef bits_type(input::width) bits_t;
+
+        DebouncedPort() : rose(0), fell(0) {
+            state = sample();
+        }
+
+        void setup() {
+            // Take the current inputs as the debounced state. Call this
+            // once the inputs (and any pullups) are configured.
+            state = sample();
+        }
+
+        void tick() {
+            bits_t change = counter.tick(sample() ^ state);
+            state ^= change;
+            rose |= change & state;
+            fell |= change & ~state;
+        }
+
+        bits_t read() {
+            // the debounced state: a bit is set while its input is active
+            return state;
+        }
+        operator bits_t() {
+            return read();
+        }
+
+        bits_t pressed() {
+            // bits that became active since the last call
+            bits_t value;
+            atomic {
+                value = rose;
+                rose = 0;
+            }
+            return value;
+        }
+
+        bits_t released() {
+            // bits that became inactive since the last call
+            bits_t value;
+            atomic {
+                value = fell;
+                fell = 0;
+            }
+            return value;
+        }
+
+    private:
+        static const bits_t all = bits_t((2ULL << (input::width - 1)) - 1);
+
+        inline bits_t sample() {
+            bits_t value = in.read();
+            return active ? value : bits_t(~value & all);
+        }
+
+        input in;
+        volatile bits_t state;
+        VerticalCounter<bits_t, samples> counter;
+        volatile bits_t rose;
+        volatile bits_t fell;
+};
+
+#endif // _DIRECTIO_DEBOUNCE_H
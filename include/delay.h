@@ -0,0 +1,169 @@
+/*
+  delay.h - Compile-time cycle delays for Direct IO and other libraries.
+  Copyright (c) 2015-2018 Michael Marchetti.  All right reserved.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _DIRECTIO_DELAY_H
+#define _DIRECTIO_DELAY_H 1
+
+// delay_cycles<N>() waits for at least N CPU cycles. The delay is
+// generated at compile time, so there is no call or setup overhead.
+// delay_ns<ns>() and delay_us<us>() convert to cycles using F_CPU,
+// rounding up.
+//
+// On AVR the delay is exact: the compiler emits a NOP/loop sequence
+// (__builtin_avr_delay_cycles). On ARM, short delays are NOP sequences
+// and longer ones wait on the DWT cycle counter (Cortex-M3/M4: SAM, SAMD51)
+// or run a counted loop (Cortex-M0+: SAMD21). ARM flash wait states can
+// stretch these slightly, so there the delay is a minimum.
+
+#if defined(ARDUINO_ARCH_AVR)
+
+template <u32 cycles>
+inline void delay_cycles() {
+    __builtin_avr_delay_cycles(cycles);
+}
+
+#elif defined(ARDUINO_ARCH_SAM) || defined(ARDUINO_ARCH_SAMD)
+
+// A sequence of n NOPs, generated by recursive template expansion.
+template <u32 n> struct _nops {
+    static inline void run() {
+        __asm__ __volatile__ ("nop");
+        _nops<n - 1>::run();
+    }
+};
+
+template <> struct _nops<0> {
+    static inline void run() {}
+};
+
+// Delays up to this many cycles are generated as NOPs
+const u32 _max_nop_cycles = 16;
+
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+// Cortex-M3 and M4 have a free-running cycle counter,
+// which can also be used for timing longer operations.
+#define DIRECTIO_CYCLE_COUNTER 1
+
+inline void cycle_counter_setup() {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+inline u32 cycle_count() {
+    return DWT->CYCCNT;
+}
+
+inline void wait_cycles(u32 start, u32 cycles) {
+    // wait until cycles have elapsed since cycle_count() returned start
+    while(DWT->CYCCNT - start < cycles) {}
+}
+
+template <u32 cycles, bool short_delay=(cycles <= _max_nop_cycles)>
+struct _delay_cycles {
+    static inline void run() {
+        u32 start = DWT->CYCCNT;
+
+        // the counter resumes from its last value when enabled,
+        // so it is safe to enable it after reading the start time.
+        cycle_counter_setup();
+        wait_cycles(start, cycles);
+    }
+};
+
+#else
+// Cortex-M0+ has no cycle counter; count down in a loop instead.
+
+template <u32 cycles, bool short_delay=(cycles <= _max_nop_cycles)>
+struct _delay_cycles {
+    static inline void run() {
+        u32 n = cycles / 3;
+
+        // 3 cycles per iteration
+        __asm__ __volatile__ (
+            "1:            \n"
+            "   sub %0, #1 \n"
+            "   bne 1b     \n"
+            : "+r" (n)
+            :
+            : "cc"
+        );
+        _nops<cycles % 3>::run();
+    }
+};
+
+#endif
+
+template <u32 cycles>
+struct _delay_cycles<cycles, true> {
+    static inline void run() {
+        _nops<cycles>::run();
+    }
+};
+
+template <u32 cycles>
+inline void delay_cycles() {
+    _delay_cycles<cycles>::run();
+}
+
+#endif
+
+#if defined(ARDUINO_ARCH_AVR) || defined(ARDUINO_ARCH_SAM) || defined(ARDUINO_ARCH_SAMD)
+
+// Convert a time to a number of CPU cycles, rounding up
+template <u32 ns> struct _ns_to_cycles {
+    static const u32 cycles = u32(((unsigned long long)(ns) * F_CPU + 999999999ULL) / 1000000000ULL);
+};
+
+template <u32 ns>
+inline void delay_ns() {
+    delay_cycles<_ns_to_cycles<ns>::cycles>();
+}
+
+template <u32 us>
+inline void delay_us() {
+    delay_cycles<_ns_to_cycles<us * 1000UL>::cycles>();
+}
+
+#else // unsupported architecture
+
+// No cycle-level timing is available, so delays are rounded up to whole microseconds.
+template <u32 cycles>
+inline void delay_cycles() {
+    if(cycles > 0) {
+        delayMicroseconds((cycles + clockCyclesPerMicrosecond() - 1) / clockCyclesPerMicrosecond());
+    }
+}
+
+template <u32 ns>
+inline void delay_ns() {
+    if(ns > 0) {
+        delayMicroseconds((ns + 999) / 1000);
+    }
+}
+
+template <u32 us>
+inline void delay_us() {
+    if(us > 0) {
+        delayMicroseconds(us);
+    }
+}
+
+#endif
+
+#endif // _DIRECTIO_DELAY_H
@@ -56,8 +56,13 @@ typedef volatile port_data_t* port_t;
         static inline u8 port_input_read() { return *port_t(in); } \
         static inline void port_output_write(u8 value) { *port_t(out) = value; } \
         static inline u8 port_output_read() { return *port_t(in); } \
+        static inline u8 port_output_latch() { return *port_t(out); } \
         static inline void port_enable_outputs(u8 mask) { *port_t(dir) |= mask; } \
         static inline void port_enable_inputs(u8 mask) { *port_t(dir) &= ~mask; } \
+        static inline void port_make_outputs(u8 mask) { *port_t(dir) |= mask; } \
+        static inline void port_make_inputs(u8 mask) { *port_t(dir) &= ~mask; } \
+        static inline void port_output_set(u8 mask) { *port_t(out) |= mask; } \
+        static inline void port_output_clear(u8 mask) { *port_t(out) &= ~mask; } \
     }
 
 #ifdef PINA
@@ -128,6 +133,7 @@ template <u8 pin> struct _pins {};
         static inline boolean input_read() { return bitRead(*port_t(in), bit); } \
         static inline void output_write(boolean value) { bitWrite(*port_t(out), bit, value); } \
         static inline boolean output_read() { return bitRead(*port_t(in), bit); } \
+        static inline void output_enable(boolean value) { bitWrite(*port_t(dir), bit, value); } \
     }
 
 // Define the correct ports/pins based on the Arduino board selected.
@@ -24,6 +24,9 @@
 typedef u32 port_data_t;
 typedef volatile port_data_t* port_t;
 
+// port_enable_outputs and port_enable_inputs fully configure the pins
+// (PIO control, pullups) via PIO_Configure. Once configured, port_make_outputs
+// and port_make_inputs switch the pin direction with a single register store.
 #define _define_port(NAME, PIO) \
     struct NAME { \
         static const u32 pio = u32(PIO); \
@@ -32,8 +35,13 @@ typedef volatile port_data_t* port_t;
             ((Pio*)pio)->PIO_ODSR = value; \
         } \
         static inline u32 port_output_read() { return ((Pio*)pio)->PIO_ODSR; } \
+        static inline u32 port_output_latch() { return ((Pio*)pio)->PIO_ODSR; } \
         static inline void port_enable_outputs(u32 mask) { PIO_Configure((Pio*)pio, PIO_OUTPUT_0, mask, PIO_DEFAULT); } \
         static inline void port_enable_inputs(u32 mask) { PIO_Configure((Pio*)pio, PIO_INPUT, mask, PIO_DEFAULT); } \
+        static inline void port_make_outputs(u32 mask) { ((Pio*)pio)->PIO_OER = mask; } \
+        static inline void port_make_inputs(u32 mask) { ((Pio*)pio)->PIO_ODR = mask; } \
+        static inline void port_output_set(u32 mask) { ((Pio*)pio)->PIO_SODR = mask; } \
+        static inline void port_output_clear(u32 mask) { ((Pio*)pio)->PIO_CODR = mask; } \
     }
 
 #ifdef PIOA
@@ -76,6 +84,13 @@ template <u8 pin> struct _pins {};
             } \
         } \
         static inline boolean output_read() { return (PORT::port_output_read() & mask) != 0; } \
+        static inline void output_enable(boolean value) { \
+            if(value) { \
+                PORT::port_make_outputs(mask); \
+            } else { \
+                PORT::port_make_inputs(mask); \
+            } \
+        } \
     }
 
 #define atomic for(boolean _loop_=(__disable_irq(),true);_loop_; _loop_=(__enable_irq(), false))
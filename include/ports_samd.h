@@ -28,8 +28,11 @@ typedef volatile port_data_t* port_t;
         static inline u32 port_input_read() { return REG_PORT_IN##PORTNUM; } \
         static inline void port_output_write(u32 value) { REG_PORT_OUT##PORTNUM = value; } \
         static inline u32 port_output_read() { return REG_PORT_OUT##PORTNUM; } \
+        static inline u32 port_output_latch() { return REG_PORT_OUT##PORTNUM; } \
         static inline void port_enable_outputs(u32 mask) { REG_PORT_DIRSET##PORTNUM = mask; } \
         static inline void port_enable_inputs(u32 mask) { REG_PORT_DIRCLR##PORTNUM = mask; } \
+        static inline void port_make_outputs(u32 mask) { REG_PORT_DIRSET##PORTNUM = mask; } \
+        static inline void port_make_inputs(u32 mask) { REG_PORT_DIRCLR##PORTNUM = mask; } \
         static inline void port_output_set(u32 value) { REG_PORT_OUTSET##PORTNUM = value; } \
         static inline void port_output_clear(u32 value) { REG_PORT_OUTCLR##PORTNUM = value; } \
     }
@@ -74,6 +77,13 @@ template <u8 pin> struct _pins {};
             } \
         } \
         static inline boolean output_read() { return (PORT::port_output_read() & mask) != 0; } \
+        static inline void output_enable(boolean value) { \
+            if(value) { \
+                PORT::port_make_outputs(mask); \
+            } else { \
+                PORT::port_make_inputs(mask); \
+            } \
+        } \
     }
 
 #define atomic for(boolean _loop_=(__disable_irq(),true);_loop_; _loop_=(__enable_irq(), false))